@@ -0,0 +1,108 @@
+/** @file adc.h
+ *
+ * This module implements the acquisition of the potentiometers connected
+ * to the ADC of the microcontroller.
+ *
+ * Conversions are auto-triggered by the compare match B of Timer1, so
+ * no software restart is needed and samples are equally spaced in time.
+ * The channels are scanned in blocks: every channel gets
+ * ADC_OVERSAMPLE + 1 consecutive conversions, the first one is discarded
+ * to let the sample and hold capacitor settle after the mux switch, and
+ * the rest are accumulated and decimated, adding two bits of resolution
+ * for every 4x of oversampling (16x => 10 + 2 = 12 bits).
+ *
+ * A new value is published only when it moves away from the previous one
+ * by more than ADC_HYSTERESIS, so that noise on the lsb does not cause
+ * the consumers to continuously update the PSG or the display.
+ */
+
+#ifndef AY38910A_SYNTH_ADC_H
+#define AY38910A_SYNTH_ADC_H
+
+/************************************************************************/
+/* Includes                                                             */
+/************************************************************************/
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/************************************************************************/
+/* Defines                                                              */
+/************************************************************************/
+
+#define ADC_OVERSAMPLE  16   /**< Samples accumulated per value, power of 4 */
+#define ADC_EXTRA_BITS  2    /**< log4(ADC_OVERSAMPLE)                     */
+#define ADC_BITS        (10 + ADC_EXTRA_BITS) /**< Effective resolution    */
+#define ADC_MAX_VALUE   ((1 << ADC_BITS) - 1)
+#define ADC_HYSTERESIS  3    /**< Minimum change (in lsb) to publish       */
+#define ADC_TRIGGER_HZ  4000 /**< Conversion rate, shared by all channels  */
+
+/**
+ * @brief The potentiometers scanned by the module
+ *
+ * Each one is mapped onto the ADC input it is connected to through the
+ * adc_channel_mux table, in adc.c.
+ */
+typedef enum {
+	ADC_POT_MENU,       /**< Menu value selection               */
+	ADC_POT_ENV_PERIOD, /**< Envelope generator period          */
+	ADC_POT_DETUNE,     /**< Detune of the secondary channels   */
+	ADC_POT_LFO_RATE,   /**< Rate of the low frequency modulation */
+	ADC_CHANNELS
+} adc_pot_t;
+
+/************************************************************************/
+/* Public functions                                                     */
+/************************************************************************/
+
+/**
+ * @brief Initializes the ADC and Timer1 and starts the scan
+ *
+ * Interrupts must be enabled for the acquisition to run.
+ */
+void adc_init(void);
+
+/**
+ * @brief Reads the last published value of a potentiometer
+ * @param pot the potentiometer to read
+ * @return the value, in the [0; ADC_MAX_VALUE] range
+ */
+uint16_t adc_get(adc_pot_t pot);
+
+/**
+ * @brief Copies the last published values of all the potentiometers
+ *
+ * The copy is atomic, so the values always belong to the same scan.
+ *
+ * @param values the destination array
+ */
+void adc_snapshot(uint16_t values[ADC_CHANNELS]);
+
+/**
+ * @brief Returns and clears the potentiometers that changed
+ *
+ * Bit n is set if the value of potentiometer n was published since the
+ * last call.
+ *
+ * @return a bitmask of the changed potentiometers
+ */
+uint8_t adc_changed(void);
+
+/**
+ * @brief Stops or resumes publishing the conversions
+ *
+ * While held, the values only change through adc_set: the scan keeps
+ * running but its results are dropped.
+ *
+ * @param hold true to hold the values
+ */
+void adc_hold(bool hold);
+
+/**
+ * @brief Publishes a value, as if it was converted
+ * @param pot   the potentiometer
+ * @param value the value, in the [0; ADC_MAX_VALUE] range
+ */
+void adc_set(adc_pot_t pot, uint16_t value);
+
+#endif
@@ -0,0 +1,97 @@
+/** @file arp.h
+ *
+ * This module implements the arpeggiator used to play chords larger than
+ * the CHANNEL_NUM voices of the PSG.
+ *
+ * When more notes are held than there are voices, the extra notes are
+ * added to the pool of a single channel, which then cycles through them
+ * at the arpeggio rate. Every step only rewrites the two tone period
+ * registers of the channel: the mixer and the amplitude are left as the
+ * first note of the pool set them.
+ *
+ * The steps are run by a scheduler task, whose period follows the rate.
+ * The scheduler works in whole milliseconds, so the actual rate is
+ * 1000 / (1000 / rate) Hz, e.g. 76.9 Hz for 75 Hz.
+ */
+
+#ifndef AY38910A_SYNTH_ARP_H
+#define AY38910A_SYNTH_ARP_H
+
+/************************************************************************/
+/* Includes                                                             */
+/************************************************************************/
+
+#include "ay38910a.h"
+#include "sched.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/************************************************************************/
+/* Defines                                                              */
+/************************************************************************/
+
+#define ARP_MAX_NOTES 10  /**< Notes cycled by the arpeggio channel     */
+#define ARP_RATE_MIN  50  /**< Slowest arpeggio rate (Hz)               */
+#define ARP_RATE_MAX  100 /**< Fastest arpeggio rate (Hz)               */
+#define ARP_RATE_DEF  75  /**< Default arpeggio rate (Hz)               */
+
+/************************************************************************/
+/* Public functions                                                     */
+/************************************************************************/
+
+/**
+ * @brief Initializes the arpeggiator
+ * @param ay   the PSG instance
+ * @param task the task running arp_step
+ */
+void arp_init(const ay38910a_t * ay, sched_task_t * task);
+
+/**
+ * @brief Sets the arpeggio rate
+ * @param hz the rate, clamped to ARP_RATE_MIN - ARP_RATE_MAX
+ */
+void arp_set_rate(uint8_t hz);
+
+/**
+ * @brief Adds a note to the pool of the arpeggio channel
+ *
+ * The first note added picks the channel, the following ones are added
+ * to its pool, up to ARP_MAX_NOTES. With two notes or more the channel
+ * starts cycling.
+ *
+ * @param chan the channel, only used by the first note
+ * @param id   an id of the note owner, e.g. the key index
+ * @param note the note, as passed to ay38910_play_note
+ * @return false if the pool is full
+ */
+bool arp_add(channel_t chan, uint8_t id, uint8_t note);
+
+/**
+ * @brief Removes a note from the pool
+ *
+ * With one note left, the channel stops cycling and holds it.
+ *
+ * @param id the id passed to arp_add
+ * @return the number of notes left in the pool
+ */
+uint8_t arp_remove(uint8_t id);
+
+/**
+ * @brief Checks whether a channel is the arpeggio channel
+ * @param chan the channel
+ * @return true if the pool holds notes for the channel
+ */
+bool arp_owns(channel_t chan);
+
+/**
+ * @brief Empties the pool, the arpeggio channel stops cycling
+ */
+void arp_reset(void);
+
+/**
+ * @brief Arpeggiator task body, moves to the next note of the pool
+ */
+void arp_step(void);
+
+#endif
@@ -65,6 +65,20 @@
 #define CHAN_DISABLE(c) (1 << c)
 /**@}*/
 
+/**
+ * @defgroup RegisterMacros Register map
+ * Addresses of the PSG registers, as used by the register shadow.
+ */
+/**@{*/
+#define AY38910A_REGS         14   /**< Sound related registers, R0-R13 */
+#define AY38910A_REG_NOISE    0x06
+#define AY38910A_REG_MIXER    0x07
+#define AY38910A_REG_AMP_A    0x08 /**< Followed by the B and C ones    */
+#define AY38910A_REG_ENV_FINE 0x0B
+#define AY38910A_REG_ENV_CRS  0x0C
+#define AY38910A_REG_ENV_SHP  0x0D
+/**@}*/
+
 /**
  * @defgroup AmplEnvelopeMacros Envelope and amplitude macros
  * Macros related to amplitude and envelope management.
@@ -143,10 +157,11 @@
 /************************************************************************/
 
 typedef struct {
-	port_t * bus_port;
-	port_t * ctl_port;
-	uint8_t  bc1;
-	uint8_t  bdir;
+	port_t  * bus_port;
+	port_t  * ctl_port;
+	uint8_t   bc1;
+	uint8_t   bdir;
+	uint8_t * regs; /**< Optional shadow of the AY38910A_REGS registers */
 } ay38910a_t;
 
 /**
@@ -200,7 +215,7 @@ typedef enum {
 	UP_DOWN_CUP      = FUNC_CONTINUE | FUNC_ALTERNATE | FUNC_HOLD,
 	SAWTOOTH         = FUNC_CONTINUE | FUNC_ATTACK,
 	DOWN_CUP         = FUNC_CONTINUE | FUNC_ATTACK | FUNC_HOLD,
-	TRIANGULAR       = FUNC_CONTINUE | FUNC_ATTACK
+	TRIANGULAR       = FUNC_CONTINUE | FUNC_ATTACK | FUNC_ALTERNATE
 } envelope_shape_t;
 
 
@@ -230,6 +245,38 @@ void ay38910_init(const ay38910a_t * ay, const timer_t * t);
 void ay38910_play_note(const ay38910a_t * ay, channel_t chan, uint8_t note);
 
 
+/**
+ * @brief Looks up the tone period of a note
+ *
+ * @param note the note, as passed to ay38910_play_note
+ * @return the 12-bit tone period written by ay38910_play_note
+ */
+uint16_t ay38910_note_period(uint8_t note);
+
+
+/**
+ * @brief Plays a note as a buzzer, the envelope running at the note pitch
+ *
+ * The envelope period comes from the env_notes table, the counterpart of
+ * magic_notes for a sawtooth envelope, halved for the triangular ones
+ * whose cycle is twice as long. The tone period is then derived from the
+ * envelope period (16 or 32 times it) rather than from magic_notes: both
+ * generators run at exactly the same pitch and never drift apart. The
+ * shape register is written last, restarting the envelope cycle on the
+ * note, so every note starts with the same phase between the two.
+ *
+ * There is a single envelope generator: the buzzer follows the last note
+ * played, on every channel with the envelope enabled. The envelope periods
+ * are too coarse to stay in tune from the fifth octave on.
+ *
+ * @param chan  the channel to program
+ * @param shape the envelope shape, SAWTOOTH, TRIANGULAR or their reverse
+ * @param note  the note, as passed to ay38910_play_note
+ */
+void ay38910_play_buzzer(const ay38910a_t * ay, channel_t chan, uint8_t shape,
+                         uint8_t note);
+
+
 /**
  * @brief Plays a sound on the noise channel
  *
@@ -293,4 +340,48 @@ void ay38910_set_amplitude(const ay38910a_t * ay, channel_t chan, uint8_t amp);
  */
 void ay38910_set_envelope(const ay38910a_t * ay, uint8_t shape, uint16_t freq);
 
+/**
+ * @brief Scales the envelope frequency without touching its shape
+ *
+ * Unlike ay38910_set_envelope, the shape register is not written, so the
+ * envelope cycle is not restarted.
+ *
+ * @param freq the frequency of the envelope
+ */
+void ay38910_set_envelope_period(const ay38910a_t * ay, uint16_t freq);
+
+/**
+ * @brief Writes a raw value to a register
+ *
+ * Meant for register dumps, which already hold the final register values.
+ * The I/O port direction bits of the mixer register are kept as set by
+ * ay38910_channel_mode, and writing the shape register restarts the
+ * envelope even if the value is unchanged.
+ *
+ * @param reg  the register address, 0 to AY38910A_REGS - 1
+ * @param data the value to write
+ */
+void ay38910_write_reg(const ay38910a_t * ay, uint8_t reg, uint8_t data);
+
+/**
+ * @brief Sets a function called after every register write
+ *
+ * The hook runs in the middle of the bus writes of the caller, interrupts
+ * disabled or not, it has to be short.
+ *
+ * @param hook the function, NULL to remove it
+ */
+void ay38910_on_write(void (*hook)(uint8_t reg, uint8_t data));
+
+/**
+ * @brief Reads the last value written to a register
+ *
+ * The PSG registers are write-only through this driver, so the values
+ * come from the register shadow, if the instance has one.
+ *
+ * @param reg the register address, 0 to AY38910A_REGS - 1
+ * @return the last written value, 0 if there is no shadow
+ */
+uint8_t ay38910_read_shadow(const ay38910a_t * ay, uint8_t reg);
+
 #endif /* AY38910A_H_ */
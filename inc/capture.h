@@ -0,0 +1,103 @@
+/** @file capture.h
+ *
+ * This module implements the capture of the PSG register writes, to record
+ * what the synth plays and render or archive it on the host.
+ *
+ * Every register write goes through a hook of the PSG driver, which only
+ * stores the write with the low 16 bits of the millisecond clock in a RAM
+ * ring, about 2 us per write: the encoding and the serial output are left
+ * to the capture task. The ring is either sent as it fills (live mode) or
+ * kept until it is asked for (record mode, then send).
+ *
+ * The stream starts with a header, "AY" and the 14 registers as they were
+ * when the capture started, followed by the writes, delta encoded:
+ *   - 0x00-0x0d, value: a register write, dropped from the stream when it
+ *     does not change the register, except for the envelope shape
+ *   - 0x81-0xfd:        the clock moved by (byte & 0x7f) ms
+ *   - 0xfe, lo, hi:     the clock moved by lo | hi << 8 ms
+ *   - 0xff, n:          n writes lost, the ring was full
+ * The capture task queues an empty entry after CAPTURE_KEEPALIVE_MS
+ * without writes, so that a long pause is sent as waits and the 16-bit
+ * timestamps of the ring never wrap between two entries. While the stream
+ * is sent (live and send modes) the text replies of the serial frames and
+ * the diagnostics are dropped, they would corrupt it.
+ *
+ * At 9600 baud the line takes about 400 writes per second, the vibrato of
+ * three channels is enough to outrun it; the lost writes are then marked
+ * in the stream, and the record mode keeps a full burst of CAPTURE_RING
+ * writes. scripts/aycapture.py records the stream and renders it into the
+ * raw frames read by ym2dump.py.
+ */
+
+#ifndef AY38910A_SYNTH_CAPTURE_H
+#define AY38910A_SYNTH_CAPTURE_H
+
+/************************************************************************/
+/* Includes                                                             */
+/************************************************************************/
+
+#include "ay38910a.h"
+#include "sched.h"
+
+#include <stdint.h>
+
+/************************************************************************/
+/* Defines                                                              */
+/************************************************************************/
+
+#define CAPTURE_RING    256 /**< Writes held by the ring, a power of 2 */
+#define CAPTURE_TX_MS   2   /**< Task period while sending, 2 bytes     */
+#define CAPTURE_IDLE_MS 100 /**< Task period while not sending          */
+#define CAPTURE_KEEPALIVE_MS 30000 /**< Longest pause between two entries */
+
+/**
+ * Capture modes
+ */
+#define CAPTURE_OFF    0 /**< No capture, the ring is emptied          */
+#define CAPTURE_LIVE   1 /**< Sends the writes as they come            */
+#define CAPTURE_RECORD 2 /**< Keeps the writes until CAPTURE_SEND      */
+#define CAPTURE_SEND   3 /**< Stops recording, sends the ring and stops */
+
+/************************************************************************/
+/* Typedefs                                                             */
+/************************************************************************/
+
+/**
+ * @brief Statistics of the capture
+ */
+typedef struct capture_stats_t {
+	uint32_t writes;  /**< Writes stored in the ring                   */
+	uint16_t lost;    /**< Writes lost to a full ring                  */
+	uint16_t skipped; /**< Writes left out, the register was unchanged */
+	uint32_t bytes;   /**< Stream bytes sent                           */
+} capture_stats_t;
+
+/************************************************************************/
+/* Public functions                                                     */
+/************************************************************************/
+
+/**
+ * @brief Initializes the capture, off
+ * @param ay   the PSG instance, with a register shadow
+ * @param task the task running capture_send
+ */
+void capture_init(const ay38910a_t * ay, sched_task_t * task);
+
+/**
+ * @brief Switches the capture mode
+ * @param mode one of the CAPTURE_* modes
+ */
+void capture_mode(uint8_t mode);
+
+/**
+ * @brief Capture task body, sends the stream bytes the USART can take
+ */
+void capture_send(void);
+
+/**
+ * @brief Reads the statistics
+ * @param stats where to store the statistics
+ */
+void capture_stats(capture_stats_t * stats);
+
+#endif
@@ -0,0 +1,58 @@
+/** @file clock.h
+ *
+ * This module implements the monotonic clock of the firmware, driven by
+ * the compare match interrupt of an 8-bit timer.
+ *
+ * The timer runs in CTC mode with a /64 prescaler (/256 above 16MHz) and
+ * interrupts every millisecond, where the millisecond counter is
+ * incremented. When F_CPU does not divide into a whole number of ticks
+ * per millisecond, the period is stretched by one tick now and then so
+ * that it averages to exactly 1 ms. Microseconds are derived from the
+ * counter value, with a prescaler / F_CPU resolution (4 us at 16MHz),
+ * and stay coherent with the milliseconds even when a compare match is
+ * still pending.
+ *
+ * The clock must be the only user of its timer, and clock_tick must be
+ * called from its compare match A interrupt.
+ */
+
+#ifndef AY38910A_SYNTH_CLOCK_H
+#define AY38910A_SYNTH_CLOCK_H
+
+/************************************************************************/
+/* Includes                                                             */
+/************************************************************************/
+
+#include "timer.h"
+
+#include <stdint.h>
+
+/************************************************************************/
+/* Public functions                                                     */
+/************************************************************************/
+
+/**
+ * @brief Starts the clock
+ * @param t the 8-bit timer peripheral used by the clock, with tcnt_8 and
+ *          tif_r set
+ */
+void clock_init(const timer_t * t);
+
+/**
+ * @brief Advances the clock by one millisecond, call from the timer ISR
+ */
+void clock_tick(void);
+
+/**
+ * @brief Reads the milliseconds elapsed since clock_init
+ * @return the milliseconds count, wrapping after ~49 days
+ */
+uint32_t clock_millis(void);
+
+/**
+ * @brief Reads the microseconds elapsed since clock_init
+ * @return the microseconds count, wrapping after ~71 minutes
+ */
+uint32_t clock_micros(void);
+
+#endif
@@ -1,8 +1,20 @@
 /** @file delay.h
  *
  * This module implements custom delay routines.
- * These delay aims to be as precise as possible, and are implemented in
- * assembly.
+ *
+ * The delays work for any F_CPU: the number of cycles to wait is computed
+ * at compile time from F_CPU and the requested time, rounding up, so a
+ * delay is never shorter than asked.
+ *
+ * With a constant argument (the common case in the peripheral drivers)
+ * the delay expands to __builtin_avr_delay_cycles, which generates the
+ * loop structure and the iteration counts at compile time: the delay is
+ * cycle exact and costs no call. Variable arguments fall back to a loop
+ * whose body is padded at compile time to last exactly one microsecond
+ * (or millisecond), plus a small constant overhead for the call.
+ *
+ * Constant folding requires the optimizer, which both the Debug (-Og)
+ * and the Release (-O2) builds enable.
  */
 #ifndef AY38910A_SYNTH_DELAY_LCD_H
 #define AY38910A_SYNTH_DELAY_LCD_H
@@ -17,30 +29,79 @@
 /* Defines                                                              */
 /************************************************************************/
 
+#ifndef F_CPU
+#error "delay.h requires F_CPU to be defined"
+#endif
+
+/** CPU cycles in a microsecond, rounded up */
+#define DELAY_CYCLES_PER_US ((F_CPU + 999999UL) / 1000000UL)
+
+/** CPU cycles in a millisecond, rounded up */
+#define DELAY_CYCLES_PER_MS ((F_CPU + 999UL) / 1000UL)
+
+/** CPU cycles needed to wait us microseconds, rounded up */
+#define DELAY_US_CYCLES(us) \
+	(((uint64_t)(us) * F_CPU + 999999UL) / 1000000UL)
+
+/** CPU cycles needed to wait ms milliseconds, rounded up */
+#define DELAY_MS_CYCLES(ms) \
+	(((uint64_t)(ms) * F_CPU + 999UL) / 1000UL)
+
+#if DELAY_CYCLES_PER_US < 4
+#error "delay.h requires F_CPU >= 4MHz for the variable delays"
+#endif
+
+/************************************************************************/
+/* Public functions                                                     */
+/************************************************************************/
+
+/**
+ * @brief Blocking delay loop, see delay_us
+ * @param us the number of microseconds to wait
+ */
+void delay_us_var(uint16_t us);
+
+/**
+ * @brief Blocking delay loop, see delay_ms
+ * @param ms the number of milliseconds to wait
+ */
+void delay_ms_var(uint16_t ms);
+
 /**
  * @brief Performs a blocking delay with a microsecond granularity
  *
- * This delay has a small error of exactly one cycle and is best used
- * when a specific blocking delay with microsecond granularity is needed,
- * for example when writing peripheral drivers.
- *
- * It only works with a 16MHz clock source.
+ * Cycle exact for a constant argument, best used when a specific blocking
+ * delay with microsecond granularity is needed, for example when writing
+ * peripheral drivers.
  *
  * @param us the number of microseconds to wait
  */
-void delay_us(uint16_t us);
+__attribute__((always_inline))
+static inline void delay_us(uint16_t us)
+{
+	if(__builtin_constant_p(us)) {
+		__builtin_avr_delay_cycles(DELAY_US_CYCLES(us));
+	} else {
+		delay_us_var(us);
+	}
+}
 
 /**
  * @brief Performs a blocking delay with a millisecond granularity
  *
- * This delay has a small error of n microseconds + 1, and is best used
- * when a specific blocking delay with milliseconds granularity is needed,
- * for example when writing peripheral drivers.
- *
- * It only works with a 16MHz clock source.
+ * Cycle exact for a constant argument, for example the power-on waits of
+ * the peripheral drivers.
  *
  * @param ms the number of milliseconds to wait
  */
-void delay_ms(uint16_t ms);
+__attribute__((always_inline))
+static inline void delay_ms(uint16_t ms)
+{
+	if(__builtin_constant_p(ms)) {
+		__builtin_avr_delay_cycles(DELAY_MS_CYCLES(ms));
+	} else {
+		delay_ms_var(ms);
+	}
+}
 
 #endif
@@ -0,0 +1,99 @@
+/** @file diag.h
+ *
+ * This module collects the figures measured at runtime by the firmware
+ * (boot timings, lcd, meter and task costs, key latency) and reports
+ * them over the serial line, so that they can be read on the rig without
+ * a debugger.
+ *
+ * Values are recorded with diag_set_once by the code that measures them and
+ * grouped in sections, each identified by a single char. A report is a
+ * list of "name=value" lines terminated by an empty line, e.g. for the
+ * boot section:
+ * @code
+ * keys_ready_us=1480
+ * first_note_us=2210312
+ * lcd_ready_us=74120
+ *
+ * @endcode
+ * The "stats <section>" command of scripts/ayctl.py sends the query frame
+ * and prints the report.
+ */
+
+#ifndef AY38910A_SYNTH_DIAG_H
+#define AY38910A_SYNTH_DIAG_H
+
+/************************************************************************/
+/* Includes                                                             */
+/************************************************************************/
+
+#include <stdint.h>
+
+/************************************************************************/
+/* Defines                                                              */
+/************************************************************************/
+
+#define DIAG_SECTION_BOOT  ('b') /**< Boot timings                       */
+#define DIAG_SECTION_LCD   ('l') /**< Lcd async engine statistics        */
+#define DIAG_SECTION_METER ('m') /**< Level meter refresh cost           */
+#define DIAG_SECTION_TASKS ('t') /**< Scheduler tasks run time           */
+#define DIAG_SECTION_KEYS  ('k') /**< Key-to-sound latency               */
+#define DIAG_SECTION_SEQ   ('q') /**< Sequencer events per tick          */
+#define DIAG_SECTION_DUMP  ('d') /**< Register dump decode time          */
+#define DIAG_SECTION_MOD   ('v') /**< Portamento and vibrato tick cost   */
+#define DIAG_SECTION_DRUMS ('r') /**< Percussion hits and tick cost      */
+#define DIAG_SECTION_PATCH ('p') /**< Patch switches and burst length    */
+#define DIAG_SECTION_CAPT  ('c') /**< Register capture writes and bytes   */
+#define DIAG_SECTION_INPUT ('i') /**< Input recording and replay          */
+#define DIAG_SECTION_MEM   ('s') /**< SRAM usage and stack high-water     */
+#define DIAG_SECTION_FMT   ('u') /**< Settings row formatting cost        */
+
+/************************************************************************/
+/* Typedefs                                                             */
+/************************************************************************/
+
+/**
+ * @brief Values recorded by the firmware, all times in us since main()
+ */
+typedef enum diag_value_t {
+	DIAG_BOOT_KEYS_READY, /**< First key scan, i.e. the synth can play   */
+	DIAG_BOOT_FIRST_NOTE, /**< First note played after power on          */
+	DIAG_BOOT_LCD_READY,  /**< Lcd init sequence and first UI drawn      */
+	DIAG_VALUES,
+} diag_value_t;
+
+/**
+ * @brief Sink of the report lines, e.g. the serial line
+ */
+typedef void (*diag_write_t)(const char * str);
+
+/************************************************************************/
+/* Public functions                                                     */
+/************************************************************************/
+
+/**
+ * @brief Records a value, unless one was already recorded
+ *
+ * Boot figures are one-shot, so only the first call for every value is
+ * kept: the caller does not need to track whether it already measured.
+ *
+ * @param value the value to record
+ * @param v     the measured figure
+ */
+void diag_set_once(diag_value_t value, uint32_t v);
+
+/**
+ * @brief Reads a recorded value
+ * @param value the value to read
+ * @return the recorded figure, 0 if it was never recorded
+ */
+uint32_t diag_get(diag_value_t value);
+
+/**
+ * @brief Writes the report of a section
+ * @param section one of the DIAG_SECTION_* ids, anything else only
+ *                writes the terminating empty line
+ * @param write   the sink of the report lines
+ */
+void diag_report(char section, diag_write_t write);
+
+#endif
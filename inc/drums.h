@@ -0,0 +1,136 @@
+/** @file drums.h
+ *
+ * This module implements the percussion engine of the synth, built on the
+ * noise generator of the PSG.
+ *
+ * Every kit piece (kick, snare, hats) is a short script of steps, one per
+ * drums tick, each setting the tone period, the noise period and the
+ * amplitude of the channel playing the hit; the mixer bits of the channel
+ * follow from which of the tone and noise are used by the step. A tone
+ * period that changes from step to step gives the pitch sweep of the kick
+ * and of the snare body.
+ *
+ * A hit borrows a voice for the length of its script: a free channel if
+ * there is one, the last channel otherwise. A free channel is marked as
+ * busy in the shared mixer state so that the keys do not pick it, and a
+ * busy one gets its tone period and amplitude back at the end of the hit,
+ * unless its note was released meanwhile. The keys do not take a stolen
+ * channel back before the hit ends, so the tone restored is always the
+ * one of the note that was playing. A song track cannot wait: the events
+ * it plays on a stolen channel go to drums_defer, which updates the tone
+ * and amplitude restored at the end of the hit instead of the registers.
+ *
+ * Only one hit plays at a time, a new hit cuts the previous one, so each
+ * tick runs exactly one step: at most five register writes, about 50 us,
+ * whatever the number of hits. The tick runs as a scheduler task, which
+ * is never longer than that, so the drums never hold back the keys task.
+ */
+
+#ifndef AY38910A_SYNTH_DRUMS_H
+#define AY38910A_SYNTH_DRUMS_H
+
+/************************************************************************/
+/* Includes                                                             */
+/************************************************************************/
+
+#include "ay38910a.h"
+#include "sched.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/************************************************************************/
+/* Defines                                                              */
+/************************************************************************/
+
+#define DRUMS_TICK_MS 10   /**< Duration of a script step               */
+#define DRUMS_IDLE_MS 100  /**< Task period while no hit is playing     */
+#define DRUMS_NONE    0xff /**< No kit piece                            */
+
+/**
+ * Kit pieces, the General MIDI percussion notes they answer to are listed
+ * in the kit of drums.c
+ */
+#define DRUM_KICK       0
+#define DRUM_SNARE      1
+#define DRUM_HAT_CLOSED 2
+#define DRUM_HAT_OPEN   3
+#define DRUM_PIECES     4
+
+/************************************************************************/
+/* Typedefs                                                             */
+/************************************************************************/
+
+/**
+ * @brief Statistics of the percussion engine
+ */
+typedef struct drums_stats_t {
+	uint16_t hits;   /**< Hits played                                 */
+	uint16_t steals; /**< Hits that borrowed a busy channel           */
+	uint16_t cuts;   /**< Hits cut by the next one                    */
+	uint16_t max_us; /**< Time spent in the slowest tick              */
+} drums_stats_t;
+
+/************************************************************************/
+/* Public functions                                                     */
+/************************************************************************/
+
+/**
+ * @brief Initializes the percussion engine
+ * @param ay    the PSG instance, with a register shadow
+ * @param mixer the mixer state shared with the other PSG users
+ * @param task  the task running drums_tick
+ */
+void drums_init(const ay38910a_t * ay, uint8_t * mixer, sched_task_t * task);
+
+/**
+ * @brief Plays a kit piece
+ * @param piece the piece, DRUM_KICK to DRUM_PIECES - 1
+ */
+void drums_hit(uint8_t piece);
+
+/**
+ * @brief Ends the hit playing, if any, giving its channel back
+ */
+void drums_stop(void);
+
+/**
+ * @brief Maps a General MIDI percussion note to a kit piece
+ * @param note the MIDI note number
+ * @return the piece, DRUMS_NONE if the kit has no piece for the note
+ */
+uint8_t drums_piece(uint8_t note);
+
+/**
+ * @brief Checks whether a hit is borrowing a channel
+ * @param chan the channel
+ * @return true if a hit is playing on the channel
+ */
+bool drums_borrowed(channel_t chan);
+
+/**
+ * @brief Hands the tone and amplitude of a stolen channel to the hit
+ *
+ * The channel plays them once the hit is over, in place of the ones it
+ * had when the hit started.
+ *
+ * @param chan the channel
+ * @param tone the tone period, 0 to keep the current one
+ * @param amp  the amplitude register value
+ * @return false if no hit is playing on the channel, the caller writes
+ *         the registers itself
+ */
+bool drums_defer(channel_t chan, uint16_t tone, uint8_t amp);
+
+/**
+ * @brief Drums task body, runs one script step
+ */
+void drums_tick(void);
+
+/**
+ * @brief Reads the statistics
+ * @param stats where to store the statistics
+ */
+void drums_stats(drums_stats_t * stats);
+
+#endif
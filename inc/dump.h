@@ -0,0 +1,128 @@
+/** @file dump.h
+ *
+ * This module implements a player for PSG register dumps, in the style of
+ * the YM captures: the value of the AY38910A_REGS registers sampled at
+ * every frame, usually 50 times per second.
+ *
+ * Dumps are stored in flash LZ compressed, frame after frame, and decoded
+ * as a stream: the decoder only keeps the last DUMP_WINDOW decoded bytes
+ * in SRAM, which the matches refer to. The stream is a sequence of tokens:
+ * | token       | meaning                                                |
+ * |-------------|--------------------------------------------------------|
+ * | 0x00 - 0x7f | literal run, the next token + 1 bytes are copied       |
+ * | 0x80 - 0xff | match of (token & 0x7f) + DUMP_MIN_MATCH bytes, at the |
+ * |             | distance given by the next 2 bytes (little endian)     |
+ * Runs and matches may span frames, the decoder resumes them at the next
+ * frame. The frames from the loop frame on are compressed on their own,
+ * without matches into the frames before it, so that the decoder can jump
+ * back to them. A value of 0xff for the shape register, as in the YM files,
+ * means that the register was not written in that frame.
+ *
+ * The player runs as a scheduler task with the period of the dump frame.
+ * It only writes the registers that changed since the previous frame, and
+ * measures the time spent decoding and writing each frame, available
+ * through dump_stats.
+ *
+ * scripts/ym2dump.py generates dumps in this format from YM files.
+ */
+
+#ifndef AY38910A_SYNTH_DUMP_H
+#define AY38910A_SYNTH_DUMP_H
+
+/************************************************************************/
+/* Includes                                                             */
+/************************************************************************/
+
+#include "ay38910a.h"
+#include "sched.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/************************************************************************/
+/* Defines                                                              */
+/************************************************************************/
+
+#ifndef DUMP_WINDOW
+#define DUMP_WINDOW    256  /**< Decode window in SRAM, a power of 2   */
+#endif
+
+#define DUMP_MIN_MATCH 3    /**< Shortest match of the stream          */
+#define DUMP_NO_WRITE  0xff /**< Shape register not written           */
+#define DUMP_IDLE_MS   100  /**< Task period while no dump is playing  */
+
+/************************************************************************/
+/* Typedefs                                                             */
+/************************************************************************/
+
+/**
+ * @brief A register dump, stored in flash with its compressed stream
+ */
+typedef struct dump_t {
+	uint8_t         frame_ms; /**< Duration of a frame                  */
+	uint16_t        window;   /**< Window the stream was compressed for */
+	uint16_t        frames;   /**< Number of frames                     */
+	uint16_t        loop;     /**< Frame to loop to, frames to stop     */
+	uint16_t        loop_at;  /**< Stream offset of the loop frame      */
+	const uint8_t * data;     /**< Compressed stream                    */
+} dump_t;
+
+/**
+ * @brief Cost statistics of the dump player
+ */
+typedef struct dump_stats_t {
+	uint32_t frames;        /**< Frames played                        */
+	uint32_t writes;        /**< Registers written                    */
+	uint16_t decode_us;     /**< Decode time of the last frame        */
+	uint16_t max_decode_us; /**< Decode time of the slowest frame     */
+	uint16_t max_frame_us;  /**< Decode and write time of the slowest */
+} dump_stats_t;
+
+/************************************************************************/
+/* Public functions                                                     */
+/************************************************************************/
+
+/**
+ * @brief Initializes the dump player
+ * @param ay    the PSG instance
+ * @param mixer the mixer state of the other PSG users, restored on stop
+ * @param task  the task running dump_frame
+ */
+void dump_init(const ay38910a_t * ay, uint8_t * mixer, sched_task_t * task);
+
+/**
+ * @brief Starts playing a dump from its first frame
+ * @param dump the dump, in flash
+ * @return false if the dump needs a larger window than DUMP_WINDOW
+ */
+bool dump_play(const dump_t * dump);
+
+/**
+ * @brief Stops the playing dump and silences the PSG
+ */
+void dump_stop(void);
+
+/**
+ * @brief Checks whether a dump is playing
+ * @return true if a dump is playing
+ */
+bool dump_playing(void);
+
+/**
+ * @brief Dump player task body, decodes and writes one frame
+ */
+void dump_frame(void);
+
+/**
+ * @brief Reads the cost statistics
+ * @param stats where to store the statistics
+ */
+void dump_stats(dump_stats_t * stats);
+
+/************************************************************************/
+/* Dumps                                                                */
+/************************************************************************/
+
+extern const dump_t dump_demo; /**< src/dump_demo.c */
+
+#endif
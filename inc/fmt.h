@@ -0,0 +1,88 @@
+/** @file fmt.h
+ *
+ * This module implements a minimal set of formatting routines, used to
+ * build the strings shown on the lcd without relying on snprintf.
+ *
+ * Any printf-like call pulls the avr-libc vfprintf implementation in the
+ * final image and goes through its format parsing state machine at every
+ * call. These routines only do what the UI needs: fixed-width decimal and
+ * hex fields, and padded labels. Digits are extracted by subtracting
+ * powers of ten, so no division routine is ever called.
+ *
+ * Every routine writes at dst, terminates the string and returns a
+ * pointer to the terminator, so that calls can be chained:
+ * @code
+ * char * p = fmt_str(buf, "amp: ", 0);
+ * p = fmt_udec(p, amp, 2, ' ');
+ * @endcode
+ *
+ * The caller must make sure that the destination buffer is large enough.
+ * Building with -DUI_SNPRINTF=ON restores the snprintf based UI, so that
+ * the two images can be compared with the size target, and the time taken
+ * to format the settings row with the "stats u" command of ayctl.py.
+ */
+
+#ifndef AY38910A_SYNTH_FMT_H
+#define AY38910A_SYNTH_FMT_H
+
+/************************************************************************/
+/* Includes                                                             */
+/************************************************************************/
+
+#include <stdint.h>
+
+/************************************************************************/
+/* Public functions                                                     */
+/************************************************************************/
+
+/**
+ * @brief Formats an unsigned value in decimal notation
+ * @param dst   the destination buffer
+ * @param v     the value to format
+ * @param width the minimum width of the field, 0 for no padding
+ * @param pad   the char used to left-pad the field, e.g. ' ' or '0'
+ * @return a pointer to the string terminator
+ */
+char * fmt_udec(char * dst, uint16_t v, uint8_t width, char pad);
+
+/**
+ * @brief Formats an unsigned 32-bit value in decimal notation, no padding
+ *
+ * Meant for diagnostics (counters, microseconds), not for the lcd hot
+ * path: the 32-bit subtractions are about four times slower than the
+ * ones of fmt_udec.
+ *
+ * @param dst the destination buffer, at least 11 chars long
+ * @param v   the value to format
+ * @return a pointer to the string terminator
+ */
+char * fmt_udec32(char * dst, uint32_t v);
+
+/**
+ * @brief Formats an unsigned value in hex notation, lowercase
+ * @param dst    the destination buffer
+ * @param v      the value to format
+ * @param digits the number of digits to print, 1-4
+ * @return a pointer to the string terminator
+ */
+char * fmt_hex(char * dst, uint16_t v, uint8_t digits);
+
+/**
+ * @brief Copies a label, right-padding it with spaces
+ * @param dst   the destination buffer
+ * @param src   a null terminated string
+ * @param width the minimum width of the field, 0 for no padding
+ * @return a pointer to the string terminator
+ */
+char * fmt_str(char * dst, const char * src, uint8_t width);
+
+/**
+ * @brief Same as fmt_str, for a label stored in flash, e.g. with PSTR
+ * @param dst   the destination buffer
+ * @param src   a null terminated string, in flash
+ * @param width the minimum width of the field, 0 for no padding
+ * @return a pointer to the string terminator
+ */
+char * fmt_str_P(char * dst, const char * src, uint8_t width);
+
+#endif
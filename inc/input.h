@@ -0,0 +1,140 @@
+/** @file input.h
+ *
+ * This module implements the recording and the replay of the inputs of
+ * the synth, to play the same performance again on the firmware: to
+ * reproduce a bug reported from a live session, or to compare two builds
+ * (a debouncer or voice allocation rewrite) on the same workload, with
+ * the register capture of capture.h as the output to compare.
+ *
+ * The inputs are recorded where the firmware reads them:
+ *   - the pins of the watched ports (keys, menu buttons), sampled every
+ *     millisecond, i.e. at the rate of the key debouncer, and recorded
+ *     once they have been stable for INPUT_SETTLE_MS: the contact bounces
+ *     are left out, the replay gives the debouncer clean edges, settled
+ *     INPUT_SETTLE_MS later than the original ones
+ *   - the published values of the potentiometers
+ *   - the USART bytes, from the receive interrupt
+ * each as a timestamped event. The replay then feeds them back at the same
+ * place: the watched ports get their input register pointed to a RAM copy
+ * holding the recorded levels, so the pin change and debouncing code runs
+ * unchanged, the ADC publishing is held and the values set by hand, and
+ * the bytes are passed to the frame receiver as if they were received.
+ * The replies to the replayed frames are not sent, they would mix with
+ * the register capture of the replay.
+ *
+ * The recording starts from a snapshot of the watched ports, of the
+ * potentiometers and of an application state (the settings), restored
+ * before the replay. The events follow, 4 bytes each:
+ * | bytes 0-1     | byte 2                      | byte 3               |
+ * |---------------|-----------------------------|----------------------|
+ * | ms since the  | 0x00-0x0f: port n           | pin levels           |
+ * | previous one  | 0x20: USART byte            | byte                 |
+ * | little endian | 0x7f: nothing, a long pause | 0                    |
+ * |               | 0x80 + pot << 4 + value msb | value lsb            |
+ * The recording is kept in SRAM, INPUT_BUFFER bytes, in the same format it
+ * is sent and loaded over the USART: scripts/ayinput.py stores it on the
+ * host and loads it back into another device or build.
+ */
+
+#ifndef AY38910A_SYNTH_INPUT_H
+#define AY38910A_SYNTH_INPUT_H
+
+/************************************************************************/
+/* Includes                                                             */
+/************************************************************************/
+
+#include "pin_config.h"
+#include "sched.h"
+
+#include <stdint.h>
+
+/************************************************************************/
+/* Defines                                                              */
+/************************************************************************/
+
+#ifndef INPUT_BUFFER
+#if defined(__AVR_ATmega2560__)
+#define INPUT_BUFFER    1024 /**< Recording size, header included       */
+#else
+#define INPUT_BUFFER    512
+#endif
+#endif
+
+#define INPUT_PORTS     4   /**< Watched ports                          */
+#define INPUT_SETTLE_MS 8   /**< Stable time of a recorded pin change   */
+#define INPUT_STATE_MAX 8   /**< Size of the application state          */
+#define INPUT_TICK_MS   1   /**< Sampling and replay period             */
+#define INPUT_IDLE_MS   100 /**< Task period while off                  */
+
+/**
+ * Input modes
+ */
+#define INPUT_OFF    0 /**< Neither recording nor replaying            */
+#define INPUT_RECORD 1 /**< Records the inputs, from a new snapshot    */
+#define INPUT_REPLAY 2 /**< Replays the recording, then goes off       */
+#define INPUT_SEND   3 /**< Sends the recording, then goes off         */
+#define INPUT_LOAD   4 /**< Empties the recording, see input_load      */
+
+/************************************************************************/
+/* Typedefs                                                             */
+/************************************************************************/
+
+/**
+ * @brief Statistics of the recording and of the replay
+ */
+typedef struct input_stats_t {
+	uint16_t recorded; /**< Events recorded                             */
+	uint16_t lost;     /**< Events lost, the recording was full         */
+	uint16_t replayed; /**< Events replayed                             */
+	uint16_t late_ms;  /**< Latest replayed event, from its timestamp   */
+} input_stats_t;
+
+/************************************************************************/
+/* Public functions                                                     */
+/************************************************************************/
+
+/**
+ * @brief Initializes the inputs recorder
+ * @param task    the task running input_tick
+ * @param state   the application state saved with the recording
+ * @param size    the size of the state, up to INPUT_STATE_MAX
+ * @param restore called once the state is restored, before the replay,
+ *                to apply it and reset the state the recording does not
+ *                hold (what plays, the modulations)
+ */
+void input_init(sched_task_t * task, void * state, uint8_t size,
+                void (*restore)(void));
+
+/**
+ * @brief Adds a port to the recorded inputs
+ * @param port    the port, its input register is redirected while replaying
+ * @param mask    the pins recorded
+ * @param changed called when the replay changes the pins, e.g. the pin
+ *                change handler of the port, may be NULL
+ */
+void input_watch(port_t * port, uint8_t mask, void (*changed)(void));
+
+/**
+ * @brief Switches the input mode
+ * @param mode one of the INPUT_* modes
+ */
+void input_mode(uint8_t mode);
+
+/**
+ * @brief Appends a byte to the recording, in INPUT_LOAD mode
+ * @param byte the next byte of a recording sent by INPUT_SEND
+ */
+void input_load(uint8_t byte);
+
+/**
+ * @brief Input task body, samples or replays the inputs
+ */
+void input_tick(void);
+
+/**
+ * @brief Reads the statistics
+ * @param stats where to store the statistics
+ */
+void input_stats(input_stats_t * stats);
+
+#endif
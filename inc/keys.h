@@ -0,0 +1,119 @@
+/** @file keys.h
+ *
+ * This module implements the key scanning of the synth, driven by pin
+ * change interrupts.
+ *
+ * The first edge of a key is caught by the pin change ISR, which stores
+ * its timestamp and wakes the keys task. From then on the task samples
+ * the keys every millisecond, through the shift register debouncer of
+ * pin_config, until every key is stable again. It then sleeps and only
+ * polls every KEYS_IDLE_MS, as a fallback for missed edges.
+ *
+ * With KEYS_EARLY_NOTE_ON a press is played as soon as the task sees the
+ * first edge, without waiting for the DEBOUNCE_RES ms window: the window
+ * then only filters the bounces, and a press that turns out to be a
+ * glitch is released when the debouncer settles. Releases always wait
+ * for the window, so that bounces never chop a note.
+ *
+ * Key-to-sound latency is measured from the first edge to the return of
+ * the press handler (i.e. after the PSG registers are written) and is
+ * available through keys_stats.
+ */
+
+#ifndef AY38910A_SYNTH_KEYS_H
+#define AY38910A_SYNTH_KEYS_H
+
+/************************************************************************/
+/* Includes                                                             */
+/************************************************************************/
+
+#include "ay38910a.h"
+#include "pin_config.h"
+#include "sched.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/************************************************************************/
+/* Defines                                                              */
+/************************************************************************/
+
+#ifndef KEYS_EARLY_NOTE_ON
+#define KEYS_EARLY_NOTE_ON 1 /**< Play presses on the first edge         */
+#endif
+
+#define KEYS_SAMPLE_MS     1  /**< Debounce sampling period               */
+#define KEYS_IDLE_MS       50 /**< Fallback polling period when stable    */
+
+/************************************************************************/
+/* Typedefs                                                             */
+/************************************************************************/
+
+/**
+ * @brief A key, only pin and chan are set by the caller
+ */
+typedef struct key_t {
+	pin_t      pin;
+	channel_t  chan;              /**< Channel playing the key, if any  */
+	debounce_t db;
+	uint8_t    acted;             /**< Level last passed to the handler */
+	volatile uint8_t  raw;        /**< Level last seen by the ISR       */
+	bool       early;             /**< Pressed before the debouncer     */
+	volatile bool     edge;       /**< An edge is being debounced       */
+	volatile uint32_t edge_us;    /**< Time of the first edge           */
+} key_t;
+
+/**
+ * @brief Called by the keys task when a key is pressed or released
+ * @param key     the key
+ * @param idx     the index of the key in the keys array
+ * @param pressed true on press, false on release
+ */
+typedef void (*key_handler_t)(key_t * key, uint8_t idx, bool pressed);
+
+/**
+ * @brief Key-to-sound latency statistics
+ */
+typedef struct keys_stats_t {
+	uint16_t presses;  /**< Presses timed from an edge              */
+	uint16_t glitches; /**< Early note-ons released by the debouncer */
+	uint16_t last_us;  /**< Latency of the last press               */
+	uint16_t max_us;   /**< Latency of the slowest press            */
+	uint32_t total_us; /**< Latency of all the timed presses        */
+} keys_stats_t;
+
+/************************************************************************/
+/* Public functions                                                     */
+/************************************************************************/
+
+/**
+ * @brief Configures the key pins as inputs with pull-up
+ *
+ * The pin change interrupts of the key pins must be enabled by the
+ * caller, and keys_pin_change called from their ISRs.
+ *
+ * @param keys    the keys, active low
+ * @param n       the number of keys
+ * @param handler the press/release handler
+ * @param task    the task running keys_scan, woken on the first edge
+ */
+void keys_init(key_t * keys, uint8_t n, key_handler_t handler,
+               sched_task_t * task);
+
+/**
+ * @brief Timestamps the keys that changed, call from the pin change ISRs
+ */
+void keys_pin_change(void);
+
+/**
+ * @brief Keys task body, debounces the keys and calls the handler
+ */
+void keys_scan(void);
+
+/**
+ * @brief Reads the key-to-sound latency statistics
+ * @param stats where to store the statistics
+ */
+void keys_stats(keys_stats_t * stats);
+
+#endif
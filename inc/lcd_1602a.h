@@ -6,10 +6,30 @@
  *
  * The implementation is geared towards driving the display in 4-bit
  * mode and is limited to a certain subset of functionalities that
- * are actually needed for this firmware.
+ * are actually needed for this firmware. Boards with a free full port
+ * can use the 8-bit interface instead, halving the bus transfers.
+ *
+ * The bus width is chosen per instance through bus_mode. Defining
+ * LCD1602A_BUS_WIDTH as 4 or 8 (LCD_BUS_WIDTH in cmake) compiles a
+ * single mode in, so that the code of the other one costs nothing.
+ *
+ * If the R/W line is wired, the driver polls the busy flag after every
+ * byte instead of waiting the worst case 2 ms, so most operations only
+ * take the ~37 us they actually need. If the flag ever fails to clear in
+ * time the driver falls back to the fixed delays. The async engine polls
+ * it from its timer interrupt, a single read with sub-microsecond strobes
+ * per tick while a long command holds the queue. Polling is opt-in, per
+ * instance through use_busy_flag; the firmware sets it from
+ * LCD1602A_USE_BUSY_FLAG (LCD_BUSY_FLAG in cmake), off by default since
+ * most boards leave R/W tied to ground.
  *
  * The library offers the possibility to drive the contrast pin
  * through a PWM signal.
+ *
+ * Once lcd1602a_async_init is called, commands and data are no longer
+ * sent in a blocking fashion: they are pushed in a queue that is drained
+ * from a timer interrupt, one nibble per tick, and every function of the
+ * driver returns as soon as its bytes are queued.
  */
 
 #ifndef AY38910A_SYNTH_LCD_1602A_H
@@ -24,17 +44,59 @@
 
 #include <stdint.h>
 
+/************************************************************************/
+/* Defines                                                              */
+/************************************************************************/
+
+#define LCD1602A_ROWS 2  /**< Number of rows of the display    */
+#define LCD1602A_COLS 16 /**< Number of columns of the display */
+
+#ifndef LCD1602A_BUS_WIDTH
+#define LCD1602A_BUS_WIDTH 0 /**< 4 or 8 for a single bus mode, 0 for both */
+#endif
+
+#ifndef LCD1602A_USE_BUSY_FLAG
+#define LCD1602A_USE_BUSY_FLAG 0 /**< 1 if the board wires the R/W line */
+#endif
+
+#define LCD1602A_BUSY_FLAG 0x80 /**< Busy flag bit in the status byte */
+
+#define LCD1602A_QUEUE_LEN 128 /**< Async queue length, power of 2 */
+#define LCD1602A_TICK_US   40  /**< Async engine tick period (us)  */
+
 /************************************************************************/
 /* Typedefs                                                             */
 /************************************************************************/
 
+/**
+ * @brief The interface used to talk with the display
+ */
+typedef enum {
+	LCD1602A_BUS_4BIT = 0, /**< D7-D4 on the high nibble of bus_port */
+	LCD1602A_BUS_8BIT = 1, /**< D7-D0 on the whole bus_port, that
+	                            must not host the control lines     */
+} lcd1602a_bus_t;
+
 typedef struct lcd1602a_t {
 	port_t * ctl_port;
 	port_t * bus_port;
+	lcd1602a_bus_t bus_mode;
 	uint8_t  register_sel;
 	uint8_t  enable;
+	uint8_t  read_write;    /**< R/W pin on ctl_port, if use_busy_flag */
+	bool     use_busy_flag; /**< R/W is wired, poll the busy flag      */
 } lcd1602a_t;
 
+/**
+ * @brief Statistics of the async engine queue
+ */
+typedef struct lcd1602a_stats_t {
+	uint8_t  depth;     /**< Entries currently queued              */
+	uint8_t  max_depth; /**< Highest depth observed                */
+	uint16_t stalls;    /**< Enqueues that had to wait for a slot  */
+	uint16_t sent;      /**< Bytes sent to the controller          */
+} lcd1602a_stats_t;
+
 /************************************************************************/
 /* Public functions                                                     */
 /************************************************************************/
@@ -51,6 +113,23 @@ typedef struct lcd1602a_t {
  */
 void lcd1602a_init(const lcd1602a_t * lcd, const timer_t * t);
 
+/**
+ * @brief Initializes the lcd peripheral in background
+ *
+ * Starts the async engine and queues the same initialization sequence of
+ * lcd1602a_init, including the power-on wait, so that the call returns
+ * immediately and the rest of the system can be brought up while the
+ * display is still initializing. Anything sent afterwards is queued
+ * behind the init sequence. Interrupts must be enabled for the sequence
+ * to progress, see lcd1602a_async_init for the tick timer requirements.
+ *
+ * @param lcd  the lcd screen instance
+ * @param t    the timer peripheral to use for the contrast control
+ * @param tick the timer used to clock the async engine
+ */
+void lcd1602a_init_async(const lcd1602a_t * lcd, const timer_t * t,
+                         const timer_t * tick);
+
 /**
  * @briefs Enables the display
  * @param lcd the lcd screen instance
@@ -106,6 +185,9 @@ void lcd1602a_print(const lcd1602a_t * lcd, const char *str);
 
 /**
  * @brief Prints a c-string to the display on the specified row
+ *
+ * The rest of the row is cleared.
+ *
  * @param lcd the lcd screen instance
  * @param str a null terminated ASCII string
  * @param row the row where to print the string
@@ -140,4 +222,62 @@ void lcd1602a_print_row(const lcd1602a_t * lcd, const char *str, uint8_t row);
  */
 void lcd1602a_new_char(const lcd1602a_t * lcd, uint8_t id, const char map[8]);
 
+/**
+ * @brief Registers a new custom character, from a bitmap stored in flash
+ *
+ * Same as lcd1602a_new_char, for bitmaps declared PROGMEM.
+ *
+ * @param lcd the lcd screen instance
+ * @param id  the id to register
+ * @param map the 5x8 bitmap, in flash
+ */
+void lcd1602a_new_char_P(const lcd1602a_t * lcd, uint8_t id, const char map[8]);
+
+/**
+ * @brief Reads the busy flag and the address counter
+ *
+ * Only available if the R/W line is wired. Blocking, with microsecond
+ * strobes: the bus belongs to the async engine once it is running, which
+ * polls the flag itself from its tick, so do not call it from then on.
+ *
+ * @param lcd the lcd screen instance
+ * @return the busy flag in bit 7 (LCD1602A_BUSY_FLAG) and the address
+ *         counter in bits [6:0], 0 if the R/W line is not available
+ */
+uint8_t lcd1602a_read_status(const lcd1602a_t * lcd);
+
+/**
+ * @brief Starts the async engine
+ *
+ * From now on, commands and data are queued and clocked out by the
+ * passed timer, that must be a 16-bit one. Its compare match A interrupt
+ * must call lcd1602a_async_tick:
+ * @code
+ * ISR(TIMER3_COMPA_vect,) {
+ *     lcd1602a_async_tick();
+ * }
+ * @endcode
+ *
+ * @param lcd the lcd screen instance, already initialized
+ * @param t   the timer used to clock the engine
+ */
+void lcd1602a_async_init(const lcd1602a_t * lcd, const timer_t * t);
+
+/**
+ * @brief Advances the async engine by one tick, call from the timer ISR
+ */
+void lcd1602a_async_tick(void);
+
+/**
+ * @brief Checks whether the async engine has nothing left to send
+ * @return true if the queue is empty and the last command completed
+ */
+bool lcd1602a_idle(void);
+
+/**
+ * @brief Reads the async engine statistics
+ * @param stats where to store the statistics
+ */
+void lcd1602a_stats(lcd1602a_stats_t * stats);
+
 #endif
@@ -0,0 +1,72 @@
+/** @file lcd_fb.h
+ *
+ * This module implements a shadow framebuffer for the 1602a lcd screen.
+ *
+ * Callers draw into a RAM copy of the 2x16 display, which costs nothing
+ * on the bus. The framebuffer also tracks what the display is currently
+ * showing, so that a flush only sends the cells that actually changed,
+ * moving the cursor only when the next changed cell is not the one the
+ * HD44780 auto-increment already points to.
+ *
+ * Updating a single digit of a settings row then costs one cursor move
+ * and one char, instead of the 16 spaces + 16 chars + 2 cursor moves of
+ * a full row rewrite.
+ */
+
+#ifndef AY38910A_SYNTH_LCD_FB_H
+#define AY38910A_SYNTH_LCD_FB_H
+
+/************************************************************************/
+/* Includes                                                             */
+/************************************************************************/
+
+#include "lcd_1602a.h"
+
+#include <stdint.h>
+
+/************************************************************************/
+/* Typedefs                                                             */
+/************************************************************************/
+
+typedef struct lcd_fb_t {
+	const lcd1602a_t * lcd;
+	char back[LCD1602A_ROWS][LCD1602A_COLS];  /**< What callers drew    */
+	char front[LCD1602A_ROWS][LCD1602A_COLS]; /**< What the lcd shows   */
+} lcd_fb_t;
+
+/************************************************************************/
+/* Public functions                                                     */
+/************************************************************************/
+
+/**
+ * @brief Binds the framebuffer to an initialized lcd and clears both
+ * @param fb  the framebuffer instance
+ * @param lcd the lcd screen instance
+ */
+void lcd_fb_init(lcd_fb_t * fb, const lcd1602a_t * lcd);
+
+/**
+ * @brief Draws a c-string on a row, padding it with spaces
+ * @param fb  the framebuffer instance
+ * @param str a null terminated ASCII string, truncated to the row width
+ * @param row the row where to draw the string
+ */
+void lcd_fb_print_row(lcd_fb_t * fb, const char * str, uint8_t row);
+
+/**
+ * @brief Draws a single char
+ * @param fb  the framebuffer instance
+ * @param row the row of the cell
+ * @param col the column of the cell
+ * @param c   the char to draw
+ */
+void lcd_fb_put_char(lcd_fb_t * fb, uint8_t row, uint8_t col, char c);
+
+/**
+ * @brief Sends the cells that changed since the last flush to the lcd
+ * @param fb the framebuffer instance
+ * @return the number of cells that were sent
+ */
+uint8_t lcd_fb_flush(lcd_fb_t * fb);
+
+#endif
@@ -0,0 +1,80 @@
+/** @file mem.h
+ *
+ * This module measures the SRAM usage of the firmware at runtime, to size
+ * the queues and buffers from what the stack actually takes rather than
+ * from guesses.
+ *
+ * The SRAM holds, from the bottom up, the static data (.data, .bss and
+ * .noinit, see the budget build target), the heap, unused unless malloc is
+ * linked in, then the free space and the stack, growing down from RAMEND.
+ * Before main runs, from the .init3 section, the space between the end
+ * of the static data and RAMEND is painted with MEM_CANARY. The stack
+ * overwrites the paint as it grows, interrupts included, so the painted
+ * bytes left above the heap are the SRAM that was never used: the stack
+ * high-water mark follows. A stack byte that happens to hold the canary
+ * can only make the high-water mark a few bytes short.
+ *
+ * mem_stats scans the paint from the heap end up, about 0.5 us per free
+ * byte at 16 MHz, i.e. a few ms: it is meant for the diagnostics, not for
+ * the tasks. The tasks call mem_scan instead, which goes through
+ * MEM_SCAN_CHUNK bytes per call, about 64 us, and has the result once the
+ * scan reaches the stack. The stack may grow over the bytes already
+ * scanned meanwhile: the high-water mark is then short until the next
+ * scan.
+ */
+
+#ifndef AY38910A_SYNTH_MEM_H
+#define AY38910A_SYNTH_MEM_H
+
+/************************************************************************/
+/* Includes                                                             */
+/************************************************************************/
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/************************************************************************/
+/* Defines                                                              */
+/************************************************************************/
+
+#define MEM_CANARY     0xc5 /**< Paint of the free SRAM          */
+#define MEM_SCAN_CHUNK 128  /**< Bytes scanned per mem_scan call */
+
+/************************************************************************/
+/* Typedefs                                                             */
+/************************************************************************/
+
+/**
+ * @brief SRAM usage, in bytes
+ */
+typedef struct mem_stats_t {
+	uint16_t static_bytes; /**< .data, .bss and .noinit                    */
+	uint16_t heap_bytes;   /**< Taken by malloc, 0 without it              */
+	uint16_t stack_bytes;  /**< Stack depth of the caller                  */
+	uint16_t stack_max;    /**< Stack high-water mark, interrupts included */
+	uint16_t free_bytes;   /**< Between the heap and the stack, now        */
+	uint16_t free_min;     /**< Never used since boot                      */
+} mem_stats_t;
+
+/************************************************************************/
+/* Public functions                                                     */
+/************************************************************************/
+
+/**
+ * @brief Measures the SRAM usage
+ * @param stats where to store the usage
+ */
+void mem_stats(mem_stats_t * stats);
+
+/**
+ * @brief Measures the SRAM usage a chunk at a time
+ *
+ * Each call carries on the scan of the previous one, the next call after
+ * a complete scan starts a new one.
+ *
+ * @param stats where to store the usage, once the scan is complete
+ * @return true if the scan is complete and stats was written
+ */
+bool mem_scan(mem_stats_t * stats);
+
+#endif
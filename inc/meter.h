@@ -0,0 +1,92 @@
+/** @file meter.h
+ *
+ * This module implements a live level meter of the three PSG channels,
+ * drawn on the second row of the lcd.
+ *
+ * The row also shows the envelope shape figure, so the meter is a page of
+ * the settings menu rather than a permanent view: it is drawn while the
+ * page is open, and the figure comes back when the page is left.
+ *
+ * Levels are derived from the PSG register shadow, so the meter never
+ * touches the PSG bus: a channel muted in the mixer reads as 0, a channel
+ * in envelope mode reads as full scale and its label is shown in upper
+ * case, otherwise the fixed amplitude is shown. Bars jump up instantly
+ * and fall by one pixel per frame, like a VU meter.
+ *
+ * Each channel takes five cells: a label and a 4 cell (20 pixel) bar,
+ * built from five custom glyphs registered in CGRAM, so the three meters
+ * fill the first 15 columns of the row.
+ *
+ * Refresh budget, at METER_FPS = 25 and with the async lcd engine
+ * (two 40 us ticks per byte):
+ *   - foreground: one register shadow read per channel and a 32 cell
+ *     compare in the framebuffer flush, no bus waits;
+ *   - bus: in the worst case every label and bar cell changes, 15 chars
+ *     and 3 cursor moves, i.e. 18 * 80 us = 1.44 ms of lcd bus time per
+ *     40 ms frame (3.6%); a single falling bar costs 1-2 bytes.
+ * The measured cost is available through meter_stats, frames drawn late
+ * show up as missed deadlines of the scheduler task that draws them.
+ */
+
+#ifndef AY38910A_SYNTH_METER_H
+#define AY38910A_SYNTH_METER_H
+
+/************************************************************************/
+/* Includes                                                             */
+/************************************************************************/
+
+#include "ay38910a.h"
+#include "lcd_fb.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/************************************************************************/
+/* Defines                                                              */
+/************************************************************************/
+
+#define METER_FPS        25 /**< Refresh rate of the meter                 */
+#define METER_ROW        1  /**< Lcd row used by the meter                 */
+#define METER_GLYPH_BASE 1  /**< First of the five CGRAM ids used for bars */
+
+/************************************************************************/
+/* Typedefs                                                             */
+/************************************************************************/
+
+/**
+ * @brief Refresh cost statistics of the meter
+ */
+typedef struct meter_stats_t {
+	uint16_t frames;    /**< Frames drawn                             */
+	uint16_t cells;     /**< Lcd cells sent by all the frames         */
+	uint8_t  max_cells; /**< Lcd cells sent by the most costly frame  */
+} meter_stats_t;
+
+/************************************************************************/
+/* Public functions                                                     */
+/************************************************************************/
+
+/**
+ * @brief Registers the bar glyphs in the lcd CGRAM
+ * @param lcd the lcd screen instance
+ */
+void meter_init(const lcd1602a_t * lcd);
+
+/**
+ * @brief Draws a frame of the meter and flushes the framebuffer
+ *
+ * Call at METER_FPS, and only while the meter page of the settings menu
+ * is open (stg_meter_shown): the row is the envelope shape one otherwise.
+ *
+ * @param fb the framebuffer instance
+ * @param ay the PSG instance, which must have a register shadow
+ */
+void meter_draw(lcd_fb_t * fb, const ay38910a_t * ay);
+
+/**
+ * @brief Reads the refresh cost statistics
+ * @param stats where to store the statistics
+ */
+void meter_stats(meter_stats_t * stats);
+
+#endif
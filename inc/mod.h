@@ -0,0 +1,122 @@
+/** @file mod.h
+ *
+ * This module implements the pitch modulations of the key voices:
+ * portamento (a glide from the previous note of the channel to the new
+ * one) and vibrato (a triangle LFO shared by the three channels).
+ *
+ * Instead of jumping between the magic_notes periods, the tone period of
+ * every modulated channel is kept in 24.8 fixed point and moved at each
+ * modulation tick: the glide adds a step computed once at note on, and
+ * the vibrato adds depth * lfo / 128, one 16x8 multiplication. Only the
+ * tone period bytes that changed are written, so a channel costs at most
+ * two register writes per tick, about 20 us of bus strobes, and none at
+ * all once the glide is over and the vibrato is off.
+ *
+ * Both are off by default, the patches turn them on (see patch.h). The
+ * modulated period is kept within the 12 bits of the tone registers: the
+ * vibrato of the lowest notes would otherwise wrap the coarse byte.
+ *
+ * The tick runs as a scheduler task every MOD_TICK_MS. Its cost, bus
+ * writes included, is measured at every tick and available through
+ * mod_stats; diag reports it as microseconds per tick and as CPU cycles
+ * per channel per tick.
+ */
+
+#ifndef AY38910A_SYNTH_MOD_H
+#define AY38910A_SYNTH_MOD_H
+
+/************************************************************************/
+/* Includes                                                             */
+/************************************************************************/
+
+#include "ay38910a.h"
+#include "sched.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/************************************************************************/
+/* Defines                                                              */
+/************************************************************************/
+
+#define MOD_TICK_MS       4  /**< Modulation tick, 250 Hz               */
+#define MOD_GLIDE_MS      0  /**< Default portamento time, off          */
+#define MOD_VIB_HZ        6  /**< Default vibrato rate                  */
+#define MOD_VIB_DEPTH     0  /**< Default vibrato depth, off            */
+#define MOD_VIB_DEPTH_MAX 30 /**< Deepest vibrato, about half a tone    */
+
+/************************************************************************/
+/* Typedefs                                                             */
+/************************************************************************/
+
+/**
+ * @brief Cost statistics of the modulation tick
+ */
+typedef struct mod_stats_t {
+	uint32_t ticks;      /**< Ticks run                               */
+	uint32_t chan_ticks; /**< Modulated channels summed over the ticks */
+	uint32_t writes;     /**< Tone period registers written           */
+	uint32_t total_us;   /**< Time spent in the ticks                 */
+	uint16_t max_us;     /**< Time spent in the slowest tick          */
+} mod_stats_t;
+
+/************************************************************************/
+/* Public functions                                                     */
+/************************************************************************/
+
+/**
+ * @brief Initializes the modulations, with the default settings
+ * @param ay   the PSG instance
+ * @param task the task running mod_tick, its period is set to MOD_TICK_MS
+ */
+void mod_init(const ay38910a_t * ay, sched_task_t * task);
+
+/**
+ * @brief Sets the modulation parameters
+ * @param glide_ms  the portamento time, 0 to disable it
+ * @param vib_hz    the vibrato rate
+ * @param vib_depth the vibrato depth in permille of the period, 0 to
+ *                  disable it, up to MOD_VIB_DEPTH_MAX
+ */
+void mod_configure(uint16_t glide_ms, uint8_t vib_hz, uint8_t vib_depth);
+
+/**
+ * @brief Plays a note on a channel and starts modulating it
+ *
+ * Writes the tone period right away: the note itself, through
+ * ay38910_play_note, or the start of the glide.
+ *
+ * @param chan the channel
+ * @param note the note, as passed to ay38910_play_note
+ */
+void mod_note_on(channel_t chan, uint8_t note);
+
+/**
+ * @brief Stops modulating a channel
+ *
+ * The period reached is kept as the start of the next glide.
+ *
+ * @param chan the channel
+ */
+void mod_note_off(channel_t chan);
+
+/**
+ * @brief Stops modulating every channel and forgets the glide origins
+ *
+ * The next notes start without a glide and the vibrato from the start of
+ * its cycle, e.g. for an input replay to write the same periods every time.
+ */
+void mod_reset(void);
+
+/**
+ * @brief Modulation task body, moves the periods of one tick
+ */
+void mod_tick(void);
+
+/**
+ * @brief Reads the cost statistics
+ * @param stats where to store the statistics
+ */
+void mod_stats(mod_stats_t * stats);
+
+#endif
@@ -0,0 +1,111 @@
+/** @file patch.h
+ *
+ * This module implements the patches of the synth: a patch bundles every
+ * parameter of a sound, the amplitude or envelope mode and the noise mix
+ * of each voice, the noise period, the envelope shape and period, and the
+ * modulations of the key voices.
+ *
+ * Applying a patch does not write the parameters one by one: the register
+ * image the patch gives is built first, registers 6 to 13, then compared
+ * with the register shadow, and only the registers that differ are
+ * written, in a single burst with the interrupts off. The chip goes from
+ * the old sound to the new one at once, without ever playing a mix of the
+ * two, in at most eight register writes, about 80 us. The shape register
+ * is only part of the delta when the shape changes, so switching between
+ * patches with the same envelope does not restart it.
+ *
+ * The amplitudes of the silent voices stay 0, the patch amplitude of a
+ * voice is picked up with patch_amp by the next note played on it. The
+ * playing voices only get a new amplitude when the patch changes it, so
+ * the level set by a song is kept while, e.g., the envelope period moves.
+ */
+
+#ifndef AY38910A_SYNTH_PATCH_H
+#define AY38910A_SYNTH_PATCH_H
+
+/************************************************************************/
+/* Includes                                                             */
+/************************************************************************/
+
+#include "ay38910a.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/************************************************************************/
+/* Typedefs                                                             */
+/************************************************************************/
+
+/**
+ * @brief Parameters of one voice of a patch
+ */
+typedef struct patch_voice_t {
+	uint8_t amp;   /**< Fixed amplitude, with AMPL_ENV_ENABLE for the envelope */
+	bool    noise; /**< Mixes the noise in while the voice plays              */
+} patch_voice_t;
+
+/**
+ * @brief A sound, applied to the three channels at once
+ */
+typedef struct patch_t {
+	patch_voice_t voices[CHANNEL_NUM];
+	uint8_t  noise;      /**< Noise period                                  */
+	uint8_t  env_shape;  /**< Envelope shape, see envelope_shape_t          */
+	uint16_t env_period; /**< Envelope period, unused by the buzzer         */
+	bool     buzzer;     /**< The envelope follows the notes, see
+	                          ay38910_play_buzzer                           */
+	uint16_t glide_ms;   /**< Portamento time, see mod_configure            */
+	uint8_t  vib_hz;     /**< Vibrato rate                                  */
+	uint8_t  vib_depth;  /**< Vibrato depth, permille                       */
+} patch_t;
+
+/**
+ * @brief Statistics of the patch switches
+ */
+typedef struct patch_stats_t {
+	uint16_t applies; /**< Patches applied                            */
+	uint16_t writes;  /**< Registers written by the deltas            */
+	uint16_t max_us;  /**< Time spent in the longest burst            */
+} patch_stats_t;
+
+/************************************************************************/
+/* Public functions                                                     */
+/************************************************************************/
+
+/**
+ * @brief Initializes the patches
+ * @param ay    the PSG instance, with a register shadow
+ * @param mixer the mixer state shared with the other PSG users
+ */
+void patch_init(const ay38910a_t * ay, uint8_t * mixer);
+
+/**
+ * @brief Switches to a patch, writing the register delta in one burst
+ *
+ * The patch is copied, it does not need to outlive the call.
+ *
+ * @param patch the patch
+ * @return the number of registers written
+ */
+uint8_t patch_apply(const patch_t * patch);
+
+/**
+ * @brief Reads the patch in use
+ * @return the last applied patch
+ */
+const patch_t * patch_current(void);
+
+/**
+ * @brief Looks up the amplitude register of a voice, for its next note
+ * @param chan the channel
+ * @return the amplitude, as passed to ay38910_set_amplitude
+ */
+uint8_t patch_amp(channel_t chan);
+
+/**
+ * @brief Reads the statistics
+ * @param stats where to store the statistics
+ */
+void patch_stats(patch_stats_t * stats);
+
+#endif
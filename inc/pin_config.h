@@ -50,6 +50,18 @@ typedef struct pin_t {
 	uint8_t   pin;
 } pin_t;
 
+/**
+ * Non-blocking debouncer: one sample is taken per debounce_pin call and
+ * the level only changes after DEBOUNCE_RES equal samples.
+ */
+typedef struct debounce_t {
+	uint8_t samples; /**< Last samples, newest in bit 0 */
+	uint8_t level;   /**< Last stable level, 0 or 1     */
+} debounce_t;
+
+/** Initial state of a released key with pull-up */
+#define DEBOUNCE_RELEASED {.samples = 0xff, .level = 1}
+
 /************************************************************************/
 /* Public functions                                                     */
 /************************************************************************/
@@ -94,4 +106,6 @@ uint8_t read_port_mask(port_t * p, uint8_t mask);
 
 uint8_t read_debounced(pin_t p);
 
+uint8_t debounce_pin(debounce_t * d, pin_t p);
+
 #endif /* PIN_CONFIG_H_ */
@@ -0,0 +1,82 @@
+/** @file presets.h
+ *
+ * This module implements a preset bank for the synth settings, stored
+ * in the internal EEPROM of the microcontroller.
+ *
+ * Every slot owns a small ring of records, and each save appends a new
+ * record to the ring of its slot instead of overwriting the same cells,
+ * spreading the wear over PRESET_RING_LEN locations. Records carry a
+ * sequence number, used to find the newest one, and a CRC8 that allows
+ * torn writes (e.g. a power loss mid-write) to be discarded at boot.
+ *
+ * The whole bank is mirrored in SRAM, so that loading a preset never
+ * touches the EEPROM. Saves only update the mirror and are written back
+ * asynchronously, one byte at a time, from the EE_READY interrupt: the
+ * ~3.3 ms needed by every EEPROM byte write never stalls the caller.
+ */
+
+#ifndef AY38910A_SYNTH_PRESETS_H
+#define AY38910A_SYNTH_PRESETS_H
+
+/************************************************************************/
+/* Includes                                                             */
+/************************************************************************/
+
+#include "settings.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/************************************************************************/
+/* Defines                                                              */
+/************************************************************************/
+
+#define PRESET_SLOTS    8 /**< Number of available preset slots          */
+#define PRESET_RING_LEN 8 /**< Records per slot, i.e. wear leveling factor */
+#define PRESET_WORKING  0 /**< Slot holding the last used settings       */
+
+/************************************************************************/
+/* Public functions                                                     */
+/************************************************************************/
+
+/**
+ * @brief Initializes the preset bank
+ *
+ * Scans the EEPROM rings and loads the newest valid record of every slot
+ * in the SRAM mirror. Slots without a valid record are left empty.
+ * This is a blocking call, to be used at boot time.
+ */
+void preset_init(void);
+
+/**
+ * @brief Loads the settings stored in a slot
+ *
+ * Reads from the SRAM mirror, so it is safe to call from the key loop.
+ *
+ * @param slot the slot to load, 0 to PRESET_SLOTS - 1
+ * @param s    where to store the loaded settings
+ * @return true if the slot held a valid preset, false otherwise (s is
+ *         left untouched)
+ */
+bool preset_load(uint8_t slot, settings_t * s);
+
+/**
+ * @brief Saves the passed settings in a slot
+ *
+ * The SRAM mirror is updated immediately, while the EEPROM write is
+ * scheduled in background. Saving the same slot again before the
+ * previous write completed only results in the latest settings being
+ * written.
+ *
+ * @param slot the slot to save, 0 to PRESET_SLOTS - 1
+ * @param s    the settings to store
+ */
+void preset_save(uint8_t slot, const settings_t * s);
+
+/**
+ * @brief Checks whether there are pending EEPROM writes
+ * @return true if some saves are still being written back
+ */
+bool preset_busy(void);
+
+#endif
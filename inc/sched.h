@@ -0,0 +1,145 @@
+/** @file sched.h
+ *
+ * This module implements a small cooperative scheduler for periodic
+ * tasks, timed by the monotonic clock.
+ *
+ * Every task is released once per period and has to complete within the
+ * same period (its deadline is the next release). Among the released
+ * tasks the one with the earliest deadline runs first. Tasks are plain
+ * functions that must return quickly: there is no preemption, so a task
+ * that spins delays every other one.
+ *
+ * The scheduler measures the run time of every task and counts the
+ * missed deadlines, i.e. runs that completed after the next release.
+ * A late task is released again once, right away, instead of running
+ * all the releases it missed back to back.
+ *
+ * Interrupt handlers can release a task at once with sched_wake, e.g.
+ * when a serial frame is complete. The time from the release (or the
+ * wake) to the start of the task is tracked as its latency.
+ *
+ * When no task is released, the cpu is put in SLEEP_MODE_IDLE until the
+ * next interrupt: the clock tick at the latest, or any other source
+ * (pin change, USART, ADC, timers). The time spent sleeping is tracked
+ * to report the idle duty cycle.
+ */
+
+#ifndef AY38910A_SYNTH_SCHED_H
+#define AY38910A_SYNTH_SCHED_H
+
+/************************************************************************/
+/* Includes                                                             */
+/************************************************************************/
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/************************************************************************/
+/* Defines                                                              */
+/************************************************************************/
+
+#define SCHED_MAX_TASKS 12 /**< Maximum number of registered tasks */
+
+/************************************************************************/
+/* Typedefs                                                             */
+/************************************************************************/
+
+/**
+ * @brief Run time statistics of a task
+ */
+typedef struct sched_stats_t {
+	uint32_t runs;     /**< Completed runs                          */
+	uint32_t total_us; /**< Run time of all the runs                */
+	uint16_t max_us;   /**< Run time of the longest run             */
+	uint16_t missed;   /**< Runs that completed after their deadline */
+	uint16_t max_latency_us; /**< Longest release (or wake) to start */
+} sched_stats_t;
+
+/**
+ * @brief Idle statistics of the scheduler
+ */
+typedef struct sched_idle_t {
+	uint32_t sleeps;   /**< Times the cpu entered the idle sleep     */
+	uint32_t idle_us;  /**< Time spent sleeping                      */
+	uint32_t total_us; /**< Time since the first task was registered */
+} sched_idle_t;
+
+/**
+ * @brief A periodic task, statically allocated by the caller
+ *
+ * Only name, run and period_ms are set by the caller, the rest is owned
+ * by the scheduler.
+ */
+typedef struct sched_task_t {
+	const char * name;      /**< Short name used in the reports      */
+	void (*run)(void);      /**< Task body                           */
+	uint16_t     period_ms; /**< Release period, also the deadline   */
+	uint32_t     release;   /**< Next release time (ms)              */
+	volatile bool     woken;   /**< Released by sched_wake           */
+	volatile uint32_t wake_us; /**< Time of the sched_wake call      */
+	sched_stats_t stats;
+} sched_task_t;
+
+/************************************************************************/
+/* Public functions                                                     */
+/************************************************************************/
+
+/**
+ * @brief Registers a task, released right away
+ * @param task the task to register, which must outlive the scheduler
+ */
+void sched_add(sched_task_t * task);
+
+/**
+ * @brief Runs the released task with the earliest deadline, if any
+ * @return true if a task was run
+ */
+bool sched_run_once(void);
+
+/**
+ * @brief Runs the tasks forever
+ */
+void sched_run(void) __attribute__((noreturn));
+
+/**
+ * @brief Delays the next release of the running task
+ *
+ * To be called from a task body: the next release happens ms from now
+ * instead of one period after the current one, e.g. to wait for the
+ * end of a note without polling.
+ *
+ * @param ms the delay before the next release
+ */
+void sched_sleep(uint16_t ms);
+
+/**
+ * @brief Releases a task right away, ISR safe
+ *
+ * Wakes the cpu from the idle sleep (the caller being an interrupt), and
+ * the task runs as soon as the running one returns, unless other
+ * released tasks have an earlier deadline.
+ *
+ * @param task the task to release
+ */
+void sched_wake(sched_task_t * task);
+
+/**
+ * @brief Reads the idle statistics
+ * @param idle where to store the statistics
+ */
+void sched_idle(sched_idle_t * idle);
+
+/**
+ * @brief Gets the number of registered tasks
+ * @return the number of tasks
+ */
+uint8_t sched_tasks(void);
+
+/**
+ * @brief Gets a registered task, e.g. to report its statistics
+ * @param i the index of the task, in registration order
+ * @return the task
+ */
+const sched_task_t * sched_task(uint8_t i);
+
+#endif
@@ -0,0 +1,92 @@
+/** @file seq.h
+ *
+ * This module implements the sequencer engine, playing the packed songs
+ * described in song.h on the three PSG channels.
+ *
+ * The engine is tick driven: seq_tick runs as a scheduler task, with the
+ * task period set to the tick of the playing song, and never blocks. At
+ * every tick each channel either counts down its pending wait, or reads
+ * events from flash up to the next wait. The events read per channel and
+ * per tick are bounded by SEQ_MAX_EVENTS, the rest is read at the next
+ * tick, so a malformed song can never stall the other tasks.
+ *
+ * The sequencer shares the mixer state with the keys: it only enables
+ * and disables the tone bits of the channels its song uses.
+ */
+
+#ifndef AY38910A_SYNTH_SEQ_H
+#define AY38910A_SYNTH_SEQ_H
+
+/************************************************************************/
+/* Includes                                                             */
+/************************************************************************/
+
+#include "ay38910a.h"
+#include "sched.h"
+#include "song.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/************************************************************************/
+/* Defines                                                              */
+/************************************************************************/
+
+#define SEQ_MAX_EVENTS 8   /**< Events read per channel and per tick     */
+#define SEQ_IDLE_MS    100 /**< Task period while no song is playing     */
+
+/************************************************************************/
+/* Typedefs                                                             */
+/************************************************************************/
+
+/**
+ * @brief Cost statistics of the sequencer
+ */
+typedef struct seq_stats_t {
+	uint32_t ticks;      /**< Ticks played                            */
+	uint32_t events;     /**< Events read                             */
+	uint8_t  max_events; /**< Events read by the busiest tick         */
+	uint16_t deferred;   /**< Channel ticks that hit SEQ_MAX_EVENTS   */
+} seq_stats_t;
+
+/************************************************************************/
+/* Public functions                                                     */
+/************************************************************************/
+
+/**
+ * @brief Initializes the sequencer
+ * @param ay    the PSG instance
+ * @param mixer the mixer state shared with the other PSG users
+ * @param task  the task running seq_tick
+ */
+void seq_init(const ay38910a_t * ay, uint8_t * mixer, sched_task_t * task);
+
+/**
+ * @brief Starts playing a song from its beginning
+ * @param song the song, in flash
+ */
+void seq_play(const song_t * song);
+
+/**
+ * @brief Stops the playing song and silences its channels
+ */
+void seq_stop(void);
+
+/**
+ * @brief Checks whether a song is playing
+ * @return true if at least one track is still playing
+ */
+bool seq_playing(void);
+
+/**
+ * @brief Sequencer task body, plays one tick
+ */
+void seq_tick(void);
+
+/**
+ * @brief Reads the cost statistics
+ * @param stats where to store the statistics
+ */
+void seq_stats(seq_stats_t * stats);
+
+#endif
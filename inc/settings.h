@@ -1,19 +1,56 @@
 #ifndef SETTINGS_H
 #define SETTINGS_H
 
-#include <lcd_1602a.h>
+#include <lcd_fb.h>
 #include <stdint.h>
 
 #define AMP_DEF (7)
 #define OCT_DEF (4)
 #define SHP_DEF (0)
 
+#define FRAME_SETTINGS    (0)
+#define FRAME_INVALID     ('!') // Unknown subcommand, the frame is dropped
+#define FRAME_PRESET      ('p')
+#define FRAME_PRESET_SAVE ('s')
+#define FRAME_PRESET_LOAD ('l')
+#define FRAME_PATCH_APPLY ('t')
+#define FRAME_QUERY       ('?')
+#define FRAME_SONG        ('m')
+#define FRAME_SONG_PLAY   ('P')
+#define FRAME_SONG_STOP   ('S')
+#define FRAME_DUMP_PLAY   ('D')
+#define FRAME_DRUM_HIT    ('H')
+#define FRAME_DRUM_KEYS   ('K')
+#define FRAME_CAPTURE     ('C')
+#define FRAME_INPUT       ('i')
+#define FRAME_INPUT_MODE  ('I')
+#define FRAME_INPUT_BYTE  ('B')
+
+// Sources of a binary stream on the USART, see stg_mute
+#define STG_MUTE_CAPTURE  (1 << 0)
+#define STG_MUTE_INPUT    (1 << 1)
+
 enum menu_state {
 	MENU_AMPLITUDE,
 	MENU_OCTAVE,
 	MENU_WAVEFORM,
+	MENU_ARP_RATE,
+	MENU_PRESET,
+	MENU_METER,
+	MENU_MEMORY,
 };
 
+/**
+ * @brief Cost of formatting the settings row, to compare the fmt and the
+ * snprintf builds (UI_SNPRINTF)
+ */
+typedef struct stg_fmt_stats {
+	uint16_t calls;    /**< Rows formatted                */
+	uint16_t last_us;  /**< Time of the last one          */
+	uint16_t max_us;   /**< Longest one                   */
+	uint32_t total_us; /**< Sum of all, for the average   */
+} stg_fmt_stats_t;
+
 typedef struct settings_ctl {
 	pin_t   nav_pin;
 	pin_t   sel_pin;
@@ -24,16 +61,29 @@ typedef struct settings {
 	uint8_t amplitude;
 	uint8_t octave;
 	uint8_t env_shape;
+	uint8_t arp_rate;  /**< Arpeggio rate in Hz */
 } settings_t;
 
 void    stg_init(settings_ctl_t * sctl);
 void    stg_update_from_frame(settings_t * s);
 void    stg_send_frame(const settings_t * s);
 uint8_t stg_received_data(void);
-bool    stg_menu_loop(const lcd1602a_t * lcd,
+char    stg_frame_command(uint8_t * arg);
+void    stg_frame_done(void);
+void    stg_write(const char * str);
+void    stg_mute(uint8_t source, bool on);
+bool    stg_try_put(uint8_t byte);
+void    stg_on_frame(void (*hook)(void));
+void    stg_on_byte(void (*hook)(uint8_t byte));
+void    stg_inject(uint8_t byte);
+bool    stg_menu_loop(lcd_fb_t * fb,
                       const settings_ctl_t * ctl, settings_t * stg);
-void stg_print_settings(const lcd1602a_t * lcd, const settings_t * stg);
-void stg_print_shape(const lcd1602a_t * lcd, const settings_t * stg);
+void stg_print_settings(lcd_fb_t * fb, const settings_t * stg);
+void stg_print_shape(lcd_fb_t * fb, const settings_t * stg);
 uint8_t stg_get_shape_value(const settings_t * stg);
+bool    stg_is_buzzer(const settings_t * stg);
+bool    stg_in_menu(void);
+bool    stg_meter_shown(void);
+void    stg_fmt_stats(stg_fmt_stats_t * stats);
 
 #endif
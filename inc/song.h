@@ -0,0 +1,96 @@
+/** @file song.h
+ *
+ * This module defines the packed song format played by the sequencer.
+ *
+ * A song is made of patterns, short byte strings of events shared by all
+ * the tracks, and one order list per PSG channel, listing the patterns
+ * the channel plays one after the other. Repeated phrases are stored
+ * once and referenced many times. Everything lives in flash (PROGMEM),
+ * the sequencer only keeps a few read pointers per channel in SRAM.
+ *
+ * Pattern events are one byte long, except for the long wait and the
+ * drum hits:
+ * | byte        | event          | meaning                              |
+ * |-------------|----------------|--------------------------------------|
+ * | 0x00 - 0x60 | SONG_NOTE(n)   | play note n, as computed by NOTE()   |
+ * | 0x7f        | SONG_REST      | silence the channel                  |
+ * | 0x80 - 0xbf | SONG_WAIT(t)   | wait t ticks, 1 to 64                |
+ * | 0xc0 - 0xcf | SONG_VOL(v)    | fixed amplitude v for the next notes |
+ * | 0xd0        | SONG_ENV       | envelope amplitude, restarts it      |
+ * | 0xe0 nn     | SONG_WAIT_LONG | wait nn + 65 ticks, 65 to 320        |
+ * | 0xe1 nn     | SONG_DRUM      | hit the kit piece nn, see drums.h    |
+ * | 0xff        | SONG_END       | end of pattern                       |
+ * A note holds until the next note or rest of the same channel, time
+ * only advances with the wait events.
+ *
+ * Order list entries are pattern indexes, terminated by SONG_LOOP, which
+ * restarts the list, or SONG_STOP, which ends the track.
+ *
+ * Example, a two note phrase played twice on channel A at 50 ms per tick:
+ * @code
+ * static const uint8_t phrase[] PROGMEM = {
+ * 	SONG_VOL(15),
+ * 	SONG_NOTE(NOTE(C_NOTE, 2)), SONG_WAIT(10),
+ * 	SONG_NOTE(NOTE(G_NOTE, 2)), SONG_WAIT(5),
+ * 	SONG_END
+ * };
+ * static const uint8_t * const patterns[] PROGMEM = {phrase};
+ * static const uint8_t order_a[] PROGMEM = {0, 0, SONG_STOP};
+ * const song_t song PROGMEM = {
+ * 	.tick_ms = 50, .patterns = patterns, .orders = {order_a},
+ * };
+ * @endcode
+ * scripts/midi2song.py generates songs in this format from MIDI files.
+ */
+
+#ifndef AY38910A_SYNTH_SONG_H
+#define AY38910A_SYNTH_SONG_H
+
+/************************************************************************/
+/* Includes                                                             */
+/************************************************************************/
+
+#include "ay38910a.h"
+
+#include <stdint.h>
+
+/************************************************************************/
+/* Defines                                                              */
+/************************************************************************/
+
+#define SONG_NOTE(n)     ((uint8_t)(n))
+#define SONG_NOTE_MAX    0x60
+#define SONG_REST        0x7f
+#define SONG_WAIT(t)     ((uint8_t)(0x80 | ((t) - 1)))
+#define SONG_WAIT_MAX    64
+#define SONG_VOL(v)      ((uint8_t)(0xc0 | ((v) & 0x0f)))
+#define SONG_ENV         0xd0
+#define SONG_WAIT_LONG   0xe0
+#define SONG_DRUM        0xe1
+#define SONG_END         0xff
+
+#define SONG_LOOP        0xff /**< Order list end, restart the list   */
+#define SONG_STOP        0xfe /**< Order list end, stop the track     */
+
+/************************************************************************/
+/* Typedefs                                                             */
+/************************************************************************/
+
+/**
+ * @brief A song, stored in flash with all its patterns and order lists
+ */
+typedef struct song_t {
+	uint8_t  tick_ms;    /**< Duration of a sequencer tick             */
+	uint8_t  env_shape;  /**< Envelope shape used by SONG_ENV          */
+	uint16_t env_period; /**< Envelope period used by SONG_ENV         */
+	const uint8_t * const * patterns;    /**< Pattern table            */
+	const uint8_t * orders[CHANNEL_NUM]; /**< Order lists, NULL if unused */
+} song_t;
+
+/************************************************************************/
+/* Songs                                                                */
+/************************************************************************/
+
+extern const song_t song_parallax; /**< src/parallax.c */
+
+#endif
@@ -15,6 +15,11 @@ typedef struct timer8_t {
 	};
 	port_t  * ocr_a_port;
 	uint8_t   ocr_a_pin;
+	union {
+		map_io8  * tcnt_8;   // Only needed by the modules reading
+		map_io16 * tcnt_16;  // the counter, e.g. the clock
+	};
+	map_io8 * tif_r;
 } timer_t;
 
 #define	TIMER_MODE_NORMAL                0x00
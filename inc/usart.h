@@ -11,6 +11,7 @@
 /************************************************************************/
 
 #include <pin_config.h>
+#include <stdbool.h>
 
 /************************************************************************/
 /* Defines                                                              */
@@ -106,6 +107,14 @@ void usart_init(const usart_t * usart, baudrate_t baud);
  */
 void usart_write(const usart_t * usart, const char *msg);
 
+/**
+ * @brief Writes a byte through the initialized USART, if the transmit
+ * buffer is free, without waiting for it.
+ * @param byte the byte to write
+ * @retval true if the byte was written
+ */
+bool usart_try_write_byte(const usart_t * usart, uint8_t byte);
+
 /**
  * @brief Reads data through the initialized USART
  * @param msg the buffer containing the message
@@ -0,0 +1,195 @@
+"""
+Register capture tool, recording the PSG register writes streamed by the
+firmware capture mode (see inc/capture.h) and rendering them offline.
+
+The stream is a header, "AY" followed by the 14 registers at the start of
+the capture, then the writes, delta encoded:
+    - 0x00-0x0d, value: register write
+    - 0x81-0xfd:        wait (byte & 0x7f) ms
+    - 0xfe, lo, hi:     wait lo | hi << 8 ms
+    - 0xff, n:          n writes lost on the device
+
+A capture is rendered by sampling the registers at a fixed frame rate into
+a raw dump, 14 registers per frame, the shape register set to 0xff in the
+frames that do not write it: the raw input of ym2dump.py, which compresses
+it for the dump player.
+
+Usage:
+    python3 scripts/aycapture.py live /dev/ttyUSB0 -o take.cap
+    python3 scripts/aycapture.py record /dev/ttyUSB0
+    python3 scripts/aycapture.py fetch /dev/ttyUSB0 -o take.cap
+    python3 scripts/aycapture.py render take.cap -o take.bin -r 50
+    python3 scripts/aycapture.py diff old.cap new.cap
+
+The diff compares the register writes of two captures, e.g. of the same
+input replay (see ayinput.py) on two builds, and reports the first write
+that differs and how far apart in time the two streams drifted.
+"""
+
+from typing import List, Tuple
+
+import argparse
+import struct
+import sys
+
+
+regs = 14                   # AY38910A_REGS
+shape_reg = 13
+no_write = 0xff             # DUMP_NO_WRITE, shape register not written
+baud = 9600
+
+# Capture modes of inc/capture.h
+modes = {"off": b"0", "live": b"1", "record": b"2", "send": b"3"}
+
+
+def set_mode(dev, mode: str):
+    dev.write(struct.pack("<ccc", b"m", b"c", modes[mode]))
+
+
+def open_port(port: str, timeout: float):
+    import serial
+    return serial.Serial(port, baud, timeout=timeout)
+
+
+def receive(dev, out, idle_stop: bool) -> int:
+    """Copies the stream until Ctrl-C, or the line is idle if idle_stop."""
+    size = 0
+    try:
+        while True:
+            data = dev.read(256)
+            if not data and idle_stop and size > 0:
+                break
+            out.write(data)
+            size += len(data)
+    except KeyboardInterrupt:
+        pass
+    return size
+
+
+def decode(data: bytes) -> Tuple[List[int], List[Tuple[int, int, int]], int]:
+    """Returns the initial registers, the (ms, reg, value) writes and the
+    count of lost writes."""
+    if len(data) < 2 + regs or data[:2] != b"AY":
+        raise ValueError("not a capture stream")
+    init = list(data[2:2 + regs])
+    writes = []
+    lost = 0
+    t = 0
+    i = 2 + regs
+    while i < len(data):
+        b = data[i]
+        if b < regs:
+            if i + 1 >= len(data):
+                break
+            writes.append((t, b, data[i + 1]))
+            i += 2
+        elif 0x81 <= b <= 0xfd:
+            t += b & 0x7f
+            i += 1
+        elif b == 0xfe:
+            if i + 2 >= len(data):
+                break
+            t += data[i + 1] | data[i + 2] << 8
+            i += 3
+        elif b == 0xff:
+            if i + 1 >= len(data):
+                break
+            lost += data[i + 1]
+            i += 2
+        else:
+            raise ValueError(f"bad stream byte {b:#04x} at {i}")
+    return init, writes, lost
+
+
+def render(init: List[int], writes: List[Tuple[int, int, int]],
+           frame_ms: float) -> bytes:
+    state = list(init)
+    frames = bytearray()
+    end = writes[-1][0] if writes else 0
+    n_frames = int(end // frame_ms) + 1
+    w = 0
+    for f in range(n_frames):
+        shape = no_write
+        limit = (f + 1) * frame_ms
+        while w < len(writes) and writes[w][0] < limit:
+            _, reg, value = writes[w]
+            state[reg] = value
+            if reg == shape_reg:
+                shape = value
+            w += 1
+        frames += bytes(state[:shape_reg]) + bytes([shape])
+    return bytes(frames)
+
+
+def diff(a: bytes, b: bytes) -> int:
+    init_a, writes_a, lost_a = decode(a)
+    init_b, writes_b, lost_b = decode(b)
+    if lost_a or lost_b:
+        print(f"warning: writes lost on the device ({lost_a}, {lost_b})")
+    if init_a != init_b:
+        print("the initial registers differ")
+    drift = 0
+    for i, (wa, wb) in enumerate(zip(writes_a, writes_b)):
+        if wa[1:] != wb[1:]:
+            print(f"write {i} differs: R{wa[1]}={wa[2]:#04x} at {wa[0]} ms, "
+                  f"R{wb[1]}={wb[2]:#04x} at {wb[0]} ms")
+            return 1
+        drift = max(drift, abs(wa[0] - wb[0]))
+    if len(writes_a) != len(writes_b):
+        print(f"the streams differ in length: {len(writes_a)}, "
+              f"{len(writes_b)} writes")
+        return 1
+    print(f"{len(writes_a)} identical writes, timing drift up to {drift} ms")
+    return 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[1])
+    sub = parser.add_subparsers(dest="cmd", required=True)
+    for cmd, help_msg in (("live", "stream the writes until Ctrl-C"),
+                          ("record", "record the writes on the device"),
+                          ("fetch", "send the recorded writes"),
+                          ("stop", "stop the capture")):
+        p = sub.add_parser(cmd, help=help_msg)
+        p.add_argument("port", help="serial port of the synth")
+        if cmd in ("live", "fetch"):
+            p.add_argument("-o", "--output", required=True,
+                           help="capture file to write")
+    p = sub.add_parser("diff", help="compare the writes of two captures")
+    p.add_argument("captures", nargs=2, help="capture files")
+    p = sub.add_parser("render", help="render a capture into a raw dump")
+    p.add_argument("capture", help="capture file")
+    p.add_argument("-o", "--output", required=True, help="raw dump to write")
+    p.add_argument("-r", "--rate", type=int, default=50,
+                   help="frame rate of the dump, in Hz (default 50)")
+    args = parser.parse_args()
+
+    if args.cmd == "diff":
+        with open(args.captures[0], "rb") as a, open(args.captures[1], "rb") as b:
+            sys.exit(diff(a.read(), b.read()))
+
+    if args.cmd == "render":
+        with open(args.capture, "rb") as f:
+            init, writes, lost = decode(f.read())
+        frames = render(init, writes, 1000 / args.rate)
+        with open(args.output, "wb") as f:
+            f.write(frames)
+        print(f"{len(writes)} writes, {len(frames) // regs} frames, "
+              f"{lost} writes lost on the device", file=sys.stderr)
+        return
+
+    dev = open_port(args.port, 0.5)
+    if args.cmd in ("record", "stop"):
+        set_mode(dev, "record" if args.cmd == "record" else "off")
+        return
+
+    set_mode(dev, "live" if args.cmd == "live" else "send")
+    with open(args.output, "wb") as f:
+        size = receive(dev, f, args.cmd == "fetch")
+    if args.cmd == "live":
+        set_mode(dev, "off")
+    print(f"{size} bytes captured", file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
@@ -16,6 +16,8 @@ shapes = OrderedDict([
     ("sawtooth",  "/|/|/|/|/|/|/|/|/|/"),
     ("down const up",  "/‾‾‾‾‾‾‾‾‾‾‾‾‾‾‾‾‾‾"),
     ("triangular",  "/\\/\\/\\/\\/\\/\\/\\/\\/\\/"),
+    ("buzzer sawtooth",  "/|/|/|/|/|/|/|/|/|/ (at the note pitch)"),
+    ("buzzer triangular",  "/\\/\\/\\/\\/\\/\\/\\/\\/\\/ (at the note pitch)"),
 ])
 
 
@@ -25,7 +27,26 @@ def usage():
   - 'q', 'quit':                exit the tool
   - 'amplitude, octave, shape': manage settings
       - 0 <= amplitude <= 15, 0 <= octave <= 8
-      - for shape, use either its id or its string:"""
+      - for shape, use either its id or its string:
+  - 'save n', 'load n':         store/recall the settings in preset slot n
+      - 0 <= n <= 7, slot 0 holds the settings restored at boot
+  - 'play n', 'stop':           play song n from flash, stop the song
+  - 'dump n':                   play register dump n from flash
+  - 'hit n':                    hit kit piece n (kick, snare, hat, open hat)
+  - 'drums on', 'drums off':    play the kit pieces with the first keys
+  - 'patch n':                  switch to patch n (lead, noisy, pad, buzz bass)
+  - 'stats s':                  print the diagnostics of section s
+      - b: boot timings, l: lcd engine, m: level meter,
+        t: tasks run time, latency and idle duty cycle,
+        k: key-to-sound latency, q: sequencer events per tick,
+        d: register dump decode time,
+        v: portamento and vibrato cost per tick and per channel,
+        r: percussion hits and tick cost,
+        p: patch switches, registers written and burst length,
+        c: register capture writes, losses and stream bytes,
+        i: input events recorded, lost and replayed,
+        s: sram usage, stack high-water mark and free bytes,
+        u: settings row formatting time, fmt or snprintf build"""
     longest = max([len(s) for s in shapes.keys()])
     for i, shape in enumerate(shapes):
         help_msg += f"\n{i: >9} - {shape: <{longest}} {shapes[shape]}"
@@ -62,7 +83,14 @@ def list_devices() -> List[str]:
 
 
 def main():
-    ok_req = re.compile(r"^\s*[0-9]{1,2}\s*,\s*[0-9]\s*,\s*[0-7a-zA-Z]+\s*$")
+    # The shape is an id or a name, the names have spaces in them
+    ok_req = re.compile(r"^\s*[0-9]{1,2}\s*,\s*[0-9]\s*,"
+                        r"\s*([0-9]{1,2}|[a-z]+(\s+[a-z]+)*)\s*$")
+    preset_req = re.compile(r"^\s*(save|load)\s+([0-7])\s*$")
+    stats_req = re.compile(r"^\s*stats\s+([a-z])\s*$")
+    play_req = re.compile(r"^\s*(play|dump|hit)\s+([0-9])\s*$")
+    drums_req = re.compile(r"^\s*drums\s+(on|off)\s*$")
+    patch_req = re.compile(r"^\s*patch\s+([0-9])\s*$")
     dev = None
     port = ""
     try:
@@ -95,6 +123,44 @@ def main():
                 continue
             if req == "q" or req == "quit":
                 return
+            preset = preset_req.match(req)
+            if preset:
+                op, slot = preset.groups()
+                frame = struct.pack("<ccc", b"p", op[0].encode("ascii"),
+                                    slot.encode("ascii"))
+                dev.write(frame)
+                print(dev.readline())
+                continue
+            play = play_req.match(req)
+            if play:
+                op, idx = play.groups()
+                dev.write(struct.pack("<ccc", b"m", op[0].encode("ascii"),
+                                      idx.encode("ascii")))
+                continue
+            drums = drums_req.match(req)
+            if drums:
+                dev.write(struct.pack("<ccc", b"m", b"k",
+                                      b"1" if drums.group(1) == "on" else b"0"))
+                continue
+            patch = patch_req.match(req)
+            if patch:
+                dev.write(struct.pack("<ccc", b"p", b"t",
+                                      patch.group(1).encode("ascii")))
+                continue
+            if req == "stop":
+                dev.write(struct.pack("<ccc", b"m", b"s", b"0"))
+                continue
+            stats = stats_req.match(req)
+            if stats:
+                frame = struct.pack("<ccc", b"?",
+                                    stats.group(1).encode("ascii"), b"\n")
+                dev.write(frame)
+                while True:
+                    line = dev.readline().decode("ascii").strip()
+                    if not line:
+                        break
+                    print(f"  {line}")
+                continue
             if not ok_req.match(req):
                 print("Invalid format, use 'h' or 'help' for more info")
                 continue
@@ -102,7 +168,7 @@ def main():
             amp, octave, shape = req.split(",")
             amp = amp.strip()
             octave = octave.strip()
-            shape = shape.strip()
+            shape = " ".join(shape.split())
 
             ok, amp, octave, shape = validate(amp, octave, shape)
 
@@ -0,0 +1,114 @@
+"""
+Input recording tool, driving the input recorder of the firmware (see
+inc/input.h): record a performance on the synth, store it on the host and
+replay it, on the same device or on another build, to get the same
+register stream again.
+
+A recording is a header (watched ports, potentiometers and settings at the
+start) followed by 4-byte events:
+    - ms since the previous event, 16 bits little endian
+    - kind: 0x00-0x0f port, 0x20 USART byte, 0x7f pause,
+      0x80 + pot << 4 + value msb for a potentiometer
+    - pin levels, byte or value lsb
+
+Typical session, comparing two builds on the same workload:
+    python3 scripts/ayinput.py record /dev/ttyUSB0
+    # play, then
+    python3 scripts/ayinput.py stop /dev/ttyUSB0
+    python3 scripts/ayinput.py fetch /dev/ttyUSB0 -o take.in
+    # flash the other build, then
+    python3 scripts/ayinput.py load /dev/ttyUSB0 take.in
+    python3 scripts/aycapture.py live /dev/ttyUSB0 -o new.cap &
+    python3 scripts/ayinput.py replay /dev/ttyUSB0
+    python3 scripts/aycapture.py diff old.cap new.cap
+
+The recording is stopped by a frame sent over the USART, which is part of
+the recording: the replay stops itself on it.
+The pin levels are recorded once settled, without the contact bounces, and
+the firmware sends no replies while it replays: the capture of the replay
+only holds the registers.
+"""
+
+import argparse
+import struct
+import sys
+import time
+
+
+baud = 9600
+adc_channels = 4            # ADC_CHANNELS
+frame_gap = 0.01            # Pacing of the load frames (s)
+
+# Input modes of inc/input.h
+modes = {"off": 0, "record": 1, "replay": 2, "send": 3, "load": 4}
+
+
+def set_mode(dev, mode: str):
+    dev.write(struct.pack("<ccc", b"i", b"m", str(modes[mode]).encode()))
+
+
+def describe(data: bytes) -> str:
+    if len(data) < 4 or data[:2] != b"IN":
+        raise ValueError("not an input recording")
+    ports, state = data[2], data[3]
+    header = 4 + ports + 2 * adc_channels + state
+    events = data[header:]
+    total = sum(events[i] | events[i + 1] << 8
+                for i in range(0, len(events) - 3, 4))
+    return (f"{ports} ports, {state} bytes of settings, "
+            f"{len(events) // 4} events over {total / 1000:.1f} s")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[1])
+    sub = parser.add_subparsers(dest="cmd", required=True)
+    for cmd, help_msg in (("record", "start recording the inputs"),
+                          ("stop", "stop recording or replaying"),
+                          ("replay", "replay the recording on the device"),
+                          ("fetch", "store the recording on the host"),
+                          ("load", "load a stored recording")):
+        p = sub.add_parser(cmd, help=help_msg)
+        p.add_argument("port", help="serial port of the synth")
+        if cmd == "fetch":
+            p.add_argument("-o", "--output", required=True,
+                           help="recording file to write")
+        elif cmd == "load":
+            p.add_argument("recording", help="recording file")
+    p = sub.add_parser("info", help="describe a stored recording")
+    p.add_argument("recording", help="recording file")
+    args = parser.parse_args()
+
+    if args.cmd == "info":
+        with open(args.recording, "rb") as f:
+            print(describe(f.read()))
+        return
+
+    import serial
+    dev = serial.Serial(args.port, baud, timeout=0.5)
+    if args.cmd in ("record", "replay"):
+        set_mode(dev, args.cmd)
+    elif args.cmd == "stop":
+        set_mode(dev, "off")
+    elif args.cmd == "fetch":
+        set_mode(dev, "send")
+        data = b""
+        while True:
+            chunk = dev.read(256)
+            if not chunk and data:
+                break
+            data += chunk
+        with open(args.output, "wb") as f:
+            f.write(data)
+        print(describe(data), file=sys.stderr)
+    else:
+        with open(args.recording, "rb") as f:
+            data = f.read()
+        print(describe(data), file=sys.stderr)
+        set_mode(dev, "load")
+        for b in data:
+            time.sleep(frame_gap)
+            dev.write(b"i" + f"{b:02x}".encode())
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,180 @@
+"""
+Memory budget report, reading the map file written by the linker and
+telling, for each module, how much flash and SRAM it takes.
+
+The input sections of the map are summed per object file, libraries by
+archive (libc.a, libgcc.a), according to the output section they landed
+in:
+    - .text:          flash, the PROGMEM tables (.progmem*) shown apart
+    - .data:          flash (the initial values) and SRAM
+    - .bss, .noinit:  SRAM
+Note that on AVR the const tables without PROGMEM are in .data (.rodata
+is copied to SRAM at startup): a module with a large .data is the first
+to look at when SRAM runs short.
+
+The totals are checked against the memories of the MCU, or the given
+budgets, and the script fails when one is exceeded, so that the build
+target can guard the smaller atmega644. Groups of modules can be summed
+as well, e.g. the buffers of the features that are off most of the time.
+
+Usage:
+    python3 scripts/mapbudget.py ay38910a_synth.map --mcu atmega644
+    python3 scripts/mapbudget.py ay38910a_synth.map --sort sram
+    python3 scripts/mapbudget.py ay38910a_synth.map --sram 3072
+    python3 scripts/mapbudget.py ay38910a_synth.map \
+        --group buffers=dump.c,capture.c,input.c
+"""
+
+from typing import Dict, Iterator, List, Tuple
+
+import argparse
+import os
+import re
+import sys
+
+
+# Flash and SRAM sizes, in bytes
+mcus = {
+    "atmega644": (64 * 1024, 4 * 1024),
+    "atmega2560": (256 * 1024, 8 * 1024),
+}
+
+flash_sections = (".text",)
+both_sections = (".data",)
+sram_sections = (".bss", ".noinit")
+
+# An input section: name, address, size and object file. Long names are
+# alone on their line, the rest of the entry is on the next one.
+entry_re = re.compile(r"^ (\S+)\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(.+)$")
+name_re = re.compile(r"^ (\.\S+)$")
+rest_re = re.compile(r"^\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(.+)$")
+output_re = re.compile(r"^(\.\S+)")
+archive_re = re.compile(r"^(.*\.a)\((.*)\)$")
+
+
+def module_name(path: str) -> str:
+    """Object file of an input section, e.g. CMakeFiles/x.dir/src/main.c.obj
+    is main.c and /usr/lib/avr/lib/libc.a(strlen.o) is libc.a."""
+    m = archive_re.match(path.strip())
+    if m:
+        return os.path.basename(m.group(1))
+    name = os.path.basename(path.strip())
+    for ext in (".obj", ".o"):
+        if name.endswith(ext):
+            return name[:-len(ext)]
+    return name
+
+
+def input_sections(lines: List[str]) -> Iterator[Tuple[str, str, int, str]]:
+    """Yields the output section, the input section, its size and module."""
+    start = 0
+    for i, line in enumerate(lines):
+        if line.startswith("Linker script and memory map"):
+            start = i + 1
+            break
+    output = None
+    pending = None
+    for line in lines[start:]:
+        line = line.rstrip("\n")
+        m = output_re.match(line)
+        if m:
+            output = m.group(1)
+            pending = None
+            continue
+        if pending is not None:
+            r = rest_re.match(line)
+            if r:
+                yield output, pending, int(r.group(2), 16), r.group(3)
+            pending = None
+            continue
+        m = entry_re.match(line)
+        if m:
+            yield output, m.group(1), int(m.group(3), 16), m.group(4)
+            continue
+        m = name_re.match(line)
+        if m:
+            pending = m.group(1)
+
+
+def budget(lines: List[str]) -> Dict[str, List[int]]:
+    """Returns flash, progmem and SRAM bytes per module."""
+    modules = {}
+    for output, name, size, path in input_sections(lines):
+        if size == 0 or output is None:
+            continue
+        if output not in flash_sections + both_sections + sram_sections:
+            continue
+        mod = modules.setdefault(module_name(path), [0, 0, 0])
+        if output in flash_sections or output in both_sections:
+            mod[0] += size
+        if name.startswith(".progmem"):
+            mod[1] += size
+        if output in both_sections or output in sram_sections:
+            mod[2] += size
+    return modules
+
+
+def report(modules: Dict[str, List[int]], sort: str,
+           groups: List[Tuple[str, List[str]]],
+           flash_max: int, sram_max: int) -> int:
+    key = {"flash": 0, "progmem": 1, "sram": 2, "name": None}[sort]
+    rows = sorted(modules.items(),
+                  key=(lambda kv: kv[0]) if key is None
+                  else (lambda kv: (-kv[1][key], kv[0])))
+    width = max([len("module")] + [len(name) for name in modules])
+    print(f"{'module':<{width}} {'flash':>8} {'progmem':>8} {'sram':>8}")
+    for name, (flash, progmem, sram) in rows:
+        print(f"{name:<{width}} {flash:>8} {progmem:>8} {sram:>8}")
+    total = [sum(m[i] for m in modules.values()) for i in range(3)]
+    print(f"{'total':<{width}} {total[0]:>8} {total[1]:>8} {total[2]:>8}")
+    for label, members in groups:
+        sums = [sum(modules.get(m, [0, 0, 0])[i] for m in members)
+                for i in range(3)]
+        print(f"{label:<{width}} {sums[0]:>8} {sums[1]:>8} {sums[2]:>8}"
+              f"  ({', '.join(members)})")
+
+    over = 0
+    for label, used, limit in (("flash", total[0], flash_max),
+                               ("sram", total[2], sram_max)):
+        print(f"{label}: {used} of {limit} bytes "
+              f"({100 * used / limit:.1f}%), {limit - used} left")
+        if used > limit:
+            print(f"{label} budget exceeded by {used - limit} bytes",
+                  file=sys.stderr)
+            over = 1
+    return over
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[1])
+    parser.add_argument("map", help="map file of the linker (-Wl,-Map=)")
+    parser.add_argument("--mcu", default="atmega2560", choices=mcus,
+                        help="MCU whose memories are the budget")
+    parser.add_argument("--flash", type=int,
+                        help="flash budget in bytes, instead of the MCU one")
+    parser.add_argument("--sram", type=int,
+                        help="static SRAM budget in bytes, instead of the "
+                             "MCU one: leave room for the stack")
+    parser.add_argument("--group", action="append", default=[],
+                        metavar="NAME=MODULE,...",
+                        help="also print the sum of some modules")
+    parser.add_argument("--sort", default="flash",
+                        choices=("flash", "progmem", "sram", "name"),
+                        help="column the modules are sorted by")
+    args = parser.parse_args()
+
+    with open(args.map) as f:
+        modules = budget(f.readlines())
+    if not modules:
+        sys.exit(f"{args.map}: no sections found, not a map file?")
+    groups = []
+    for group in args.group:
+        label, _, members = group.partition("=")
+        groups.append((label, members.split(",")))
+    flash_max, sram_max = mcus[args.mcu]
+    sys.exit(report(modules, args.sort, groups,
+                    args.flash or flash_max, args.sram or sram_max))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,552 @@
+"""
+Song compiler, converting Standard MIDI Files into the packed song format
+played by the firmware sequencer (see inc/song.h).
+
+The conversion goes through the following steps:
+    - every note of every track is collected, with its start and end times
+      in seconds, by following the tempo map of the file. The notes of the
+      drums channel (MIDI channel 10) are mapped to the pieces of the drum
+      kit of the firmware (see inc/drums.h) and become SONG_DRUM hits on
+      the first voice, notes without a kit piece are skipped.
+    - note times are quantised to the sequencer tick. The kit plays one
+      piece at a time, so the hits of a tick are reduced to the one with
+      the lowest piece index: kick over snare over hats.
+    - the notes are reduced to the three PSG voices. A note takes a free
+      voice when there is one, otherwise it cuts the quietest sounding note
+      (the oldest one on ties), except for the highest sounding note, which
+      is considered the melody and never cut. Notes that find no voice are
+      dropped, and both cases are counted in the report.
+    - each voice is turned into a stream of events and split into patterns
+      of a fixed number of ticks (one bar by default). Identical patterns
+      are stored once and referenced by the order lists of the voices.
+
+Along with the C source of the song, the tool reports the flash footprint
+of the song and the peak number of events the sequencer reads in a single
+tick, obtained by running a model of seq_tick on the generated data. Both
+can be checked against a budget, in which case the tool fails when the song
+does not fit.
+
+Usage:
+    python3 scripts/midi2song.py song.mid -n my_song -o src/my_song.c
+The song must then be declared in inc/song.h and added to the songs table
+of src/main.c.
+
+References:
+    - Standard MIDI File format:
+        https://www.music.mcgill.ca/~ich/classes/mumt306/StandardMIDIfileformat.html
+"""
+
+from typing import Dict, List, Optional, Tuple
+
+import argparse
+import struct
+import sys
+
+
+voices = 3                  # PSG tone channels
+drums_chan = 9              # MIDI channel 10, zero based
+b0_midi = 23                # MIDI number of B0, note 0 of magic_notes
+n_notes = 97                # Notes from B0 to B8, as N_NOTES
+max_ampl = 15               # Highest fixed amplitude, as MAX_AMPL
+seq_max_events = 8          # SEQ_MAX_EVENTS of inc/seq.h
+song_desc_size = 12         # sizeof(song_t) on AVR
+
+song_rest = 0x7f
+song_wait_max = 64
+song_wait_long = 0xe0
+song_drum = 0xe1
+song_wait_long_max = 255 + song_wait_max + 1
+song_end = 0xff
+song_loop = 0xff
+song_stop = 0xfe
+max_patterns = song_stop
+
+# General MIDI percussion notes to kit pieces, as drums_piece of drums.c
+drum_kit = {35: 0, 36: 0, 37: 1, 38: 1, 40: 1, 42: 2, 44: 2, 46: 3}
+
+
+class Note:
+    def __init__(self, start: float, end: float, pitch: int, velocity: int):
+        self.start = start
+        self.end = end
+        self.pitch = pitch
+        self.velocity = velocity
+
+
+# MIDI parsing
+
+
+def read_var_len(data: bytes, pos: int) -> Tuple[int, int]:
+    value = 0
+    while True:
+        byte = data[pos]
+        pos += 1
+        value = (value << 7) | (byte & 0x7f)
+        if not byte & 0x80:
+            return value, pos
+
+
+def read_chunks(data: bytes) -> List[Tuple[bytes, bytes]]:
+    chunks = []
+    pos = 0
+    while pos + 8 <= len(data):
+        kind, size = struct.unpack(">4sI", data[pos:pos+8])
+        chunks.append((kind, data[pos+8:pos+8+size]))
+        pos += 8 + size
+    return chunks
+
+
+def read_track(data: bytes) -> List[Tuple[int, int, bytes]]:
+    """Returns the (absolute tick, status, data) events of a track."""
+    events = []
+    pos = 0
+    tick = 0
+    status = 0
+    while pos < len(data):
+        delta, pos = read_var_len(data, pos)
+        tick += delta
+        if data[pos] & 0x80:
+            status = data[pos]
+            pos += 1
+        if status == 0xff:
+            kind = data[pos]
+            size, pos = read_var_len(data, pos + 1)
+            events.append((tick, status, bytes([kind]) + data[pos:pos+size]))
+            pos += size
+        elif status in (0xf0, 0xf7):
+            size, pos = read_var_len(data, pos)
+            pos += size
+        else:
+            size = 1 if status & 0xf0 in (0xc0, 0xd0) else 2
+            events.append((tick, status, data[pos:pos+size]))
+            pos += size
+    return events
+
+
+def read_midi(path: str, keep_drums: bool) -> Tuple[List[Note],
+                                                   List[Tuple[float, int]],
+                                                   float]:
+    """Returns the notes and drum hits of a MIDI file, in seconds, and the
+    bar length."""
+    with open(path, "rb") as f:
+        chunks = read_chunks(f.read())
+    if not chunks or chunks[0][0] != b"MThd":
+        raise ValueError(f"{path} is not a Standard MIDI File")
+    _, _, division = struct.unpack(">HHH", chunks[0][1][:6])
+    if division & 0x8000:
+        raise ValueError("SMPTE time division is not supported")
+
+    tracks = [read_track(c) for k, c in chunks[1:] if k == b"MTrk"]
+
+    # Tempo map, shared by all the tracks
+    tempos = [(0, 500_000)]
+    beats_per_bar = 4
+    for track in tracks:
+        for tick, status, data in track:
+            if status == 0xff and data[0] == 0x51:
+                tempos.append((tick, int.from_bytes(data[1:4], "big")))
+            elif status == 0xff and data[0] == 0x58 and tick == 0:
+                beats_per_bar = data[1] * 4 // (1 << data[2])
+    tempos.sort(key=lambda t: t[0])
+
+    def seconds(tick: int) -> float:
+        t = 0.0
+        for i, (start, tempo) in enumerate(tempos):
+            end = tempos[i+1][0] if i + 1 < len(tempos) else tick
+            if tick <= start:
+                break
+            t += (min(tick, end) - start) * tempo / (division * 1e6)
+        return t
+
+    notes = []
+    hits = []
+    for track in tracks:
+        sounding: Dict[Tuple[int, int], List[Tuple[int, int]]] = {}
+        for tick, status, data in track:
+            kind, chan = status & 0xf0, status & 0x0f
+            if kind not in (0x80, 0x90):
+                continue
+            if chan == drums_chan and not keep_drums:
+                if kind == 0x90 and data[1] > 0 and data[0] in drum_kit:
+                    hits.append((seconds(tick), drum_kit[data[0]]))
+                continue
+            key = (chan, data[0])
+            if kind == 0x90 and data[1] > 0:
+                sounding.setdefault(key, []).append((tick, data[1]))
+            elif sounding.get(key):
+                start, velocity = sounding[key].pop(0)
+                notes.append(Note(seconds(start), seconds(tick), data[0],
+                                  velocity))
+    notes.sort(key=lambda n: (n.start, -n.pitch))
+    hits.sort()
+    bar = seconds(division * beats_per_bar) - seconds(0)
+    return notes, hits, bar
+
+
+# Song building
+
+
+def quantise(notes: List[Note], tick_s: float) -> List[Note]:
+    ret = []
+    for n in notes:
+        start = round(n.start / tick_s)
+        end = max(round(n.end / tick_s), start + 1)
+        ret.append(Note(start, end, n.pitch, n.velocity))
+    return ret
+
+
+def reduce_voices(notes: List[Note], stats: Dict[str, int]) -> List[List[Note]]:
+    """Spreads the notes over the PSG voices, cutting or dropping the extra."""
+    tracks: List[List[Note]] = [[] for _ in range(voices)]
+    for n in notes:
+        sounding = [i for i in range(voices)
+                    if tracks[i] and tracks[i][-1].end > n.start]
+        free = [i for i in range(voices) if i not in sounding]
+        if free:
+            # Keep each voice on a close register, for smoother lines
+            last = [tracks[i][-1].pitch if tracks[i] else n.pitch for i in free]
+            tracks[free[min(range(len(free)),
+                            key=lambda j: abs(last[j] - n.pitch))]].append(n)
+            continue
+
+        lead = max(sounding, key=lambda i: tracks[i][-1].pitch)
+        victims = [i for i in sounding if i != lead]
+        victim = min(victims, key=lambda i: (tracks[i][-1].velocity,
+                                             tracks[i][-1].start))
+        cut = tracks[victim][-1]
+        if n.pitch > tracks[lead][-1].pitch or n.velocity >= cut.velocity:
+            if cut.start == n.start:
+                tracks[victim].pop()
+                stats["dropped"] += 1
+            else:
+                cut.end = n.start
+                stats["cut"] += 1
+            tracks[victim].append(n)
+        else:
+            stats["dropped"] += 1
+    return tracks
+
+
+def note_index(pitch: int, stats: Dict[str, int]) -> int:
+    idx = pitch - b0_midi
+    if not 0 <= idx < n_notes:
+        stats["transposed"] += 1
+    while idx < 0:
+        idx += 12
+    while idx >= n_notes:
+        idx -= 12
+    return idx
+
+
+def one_hit_per_tick(hits: List[Tuple[int, int]],
+                     stats: Dict[str, int]) -> List[Tuple[int, int]]:
+    """Keeps the hit of the lowest piece index of every tick: a second hit
+    in the same tick would cut the first one on the single drum voice."""
+    kept: Dict[int, int] = {}
+    for tick, piece in hits:
+        if tick in kept:
+            stats["merged"] += 1
+            kept[tick] = min(kept[tick], piece)
+        else:
+            kept[tick] = piece
+    return sorted(kept.items())
+
+
+def voice_events(track: List[Note], hits: List[Tuple[int, int]], length: int,
+                 stats: Dict[str, int]) -> List[Tuple[int, List[int]]]:
+    """Returns the (tick, events) list of a voice, without waits."""
+    events: Dict[int, List[int]] = {}
+    for tick, piece in hits:
+        events.setdefault(tick, []).append(("drum", piece))
+    for i, n in enumerate(track):
+        events.setdefault(n.start, []).append(
+            ("note", note_index(n.pitch, stats),
+             max(1, n.velocity * max_ampl // 127)))
+        next_start = track[i+1].start if i + 1 < len(track) else length
+        if n.end < next_start:
+            events.setdefault(n.end, []).append(("rest",))
+    return sorted(events.items())
+
+
+def encode_wait(ticks: int) -> List[int]:
+    ret = []
+    while ticks > 0:
+        if ticks <= song_wait_max:
+            ret.append(0x80 | (ticks - 1))
+            ticks = 0
+        else:
+            chunk = min(ticks, song_wait_long_max)
+            ret += [song_wait_long, chunk - song_wait_max - 1]
+            ticks -= chunk
+    return ret
+
+
+def split_patterns(events: List[Tuple[int, List]], length: int,
+                   pattern_ticks: int) -> List[bytes]:
+    """Splits the events of a voice into patterns of pattern_ticks ticks."""
+    patterns = []
+    pos = 0
+    for start in range(0, length, pattern_ticks):
+        end = min(start + pattern_ticks, length)
+        data = []
+        now = start
+        vol = None  # Patterns are shared, the volume is set in each one
+        while pos < len(events) and events[pos][0] < end:
+            tick, evs = events[pos]
+            data += encode_wait(tick - now)
+            now = tick
+            for ev in evs:
+                if ev[0] == "rest":
+                    data.append(song_rest)
+                    continue
+                if ev[0] == "drum":
+                    data += [song_drum, ev[1]]
+                    continue
+                if ev[2] != vol:
+                    vol = ev[2]
+                    data.append(0xc0 | vol)
+                data.append(ev[1])
+            pos += 1
+        data += encode_wait(end - now)
+        data.append(song_end)
+        patterns.append(bytes(data))
+    return patterns
+
+
+def simulate(song: List[Optional[List[int]]], patterns: List[bytes],
+             loop: bool) -> Dict[str, int]:
+    """Plays the song through a model of seq_tick, counting the events."""
+    class Track:
+        pass
+
+    tracks = []
+    for order in song:
+        t = Track()
+        t.order, t.pos, t.pat, t.wait = order or [], 0, None, 0
+        t.active = bool(order)
+        tracks.append(t)
+
+    def next_pattern(t) -> bool:
+        if t.pos == len(t.order):
+            if not loop:
+                return False
+            t.pos = 0
+        t.pat, t.idx = patterns[t.order[t.pos]], 0
+        t.pos += 1
+        return True
+
+    for t in tracks:
+        t.active = t.active and next_pattern(t)
+
+    res = {"ticks": 0, "events": 0, "max_events": 0, "deferred": 0}
+    # A looping song is played once, up to its first loop
+    while any(t.active for t in tracks):
+        events = 0
+        for t in tracks:
+            if not t.active:
+                continue
+            if t.wait and t.wait - 1:
+                t.wait -= 1
+                continue
+            t.wait = 0
+            n = 0
+            while t.wait == 0 and t.active:
+                if n == seq_max_events:
+                    res["deferred"] += 1
+                    break
+                ev = t.pat[t.idx]
+                t.idx += 1
+                n += 1
+                if ev & 0xc0 == 0x80:
+                    t.wait = (ev & 0x3f) + 1
+                elif ev == song_wait_long:
+                    t.wait = t.pat[t.idx] + song_wait_max + 1
+                    t.idx += 1
+                elif ev == song_drum:
+                    t.idx += 1
+                elif ev == song_end:
+                    if loop and t.pos == len(t.order):
+                        t.active = False
+                    elif not next_pattern(t):
+                        t.active = False
+            events += n
+        res["ticks"] += 1
+        res["events"] += events
+        res["max_events"] = max(res["max_events"], events)
+    return res
+
+
+# Output
+
+
+def event_str(data: bytes, i: int) -> Tuple[str, int]:
+    ev = data[i]
+    if ev <= n_notes - 1:
+        return f"SONG_NOTE({ev})", 1
+    if ev == song_rest:
+        return "SONG_REST", 1
+    if ev & 0xc0 == 0x80:
+        return f"SONG_WAIT({(ev & 0x3f) + 1})", 1
+    if ev & 0xf0 == 0xc0:
+        return f"SONG_VOL({ev & 0x0f})", 1
+    if ev == song_wait_long:
+        return f"SONG_WAIT_LONG, {data[i+1]}", 2
+    if ev == song_drum:
+        return f"SONG_DRUM, {data[i+1]}", 2
+    return "SONG_END", 1
+
+
+def write_song(out, name: str, source: str, tick_ms: int, loop: bool,
+               patterns: List[bytes], orders: List[Optional[List[int]]]):
+    out.write('#include "song.h"\n\n#include <stddef.h>\n'
+              '#include <avr/pgmspace.h>\n\n')
+    out.write(f"/**\n * Generated by scripts/midi2song.py from {source},\n"
+              f" * {tick_ms} ms per tick.\n */\n\n")
+    for i, data in enumerate(patterns):
+        evs = []
+        pos = 0
+        while pos < len(data):
+            ev, size = event_str(data, pos)
+            evs.append(ev)
+            pos += size
+        out.write(f"static const uint8_t {name}_p{i}[] PROGMEM = {{\n")
+        for j in range(0, len(evs), 6):
+            out.write("\t" + ", ".join(evs[j:j+6]) + ",\n")
+        out.write("};\n\n")
+
+    out.write(f"static const uint8_t * const {name}_patterns[] PROGMEM = {{\n")
+    for j in range(0, len(patterns), 6):
+        out.write("\t" + ", ".join(f"{name}_p{i}" for i in
+                                   range(j, min(j + 6, len(patterns)))) + ",\n")
+    out.write("};\n\n")
+
+    end = "SONG_LOOP" if loop else "SONG_STOP"
+    for ch, order in enumerate(orders):
+        if order is None:
+            continue
+        out.write(f"static const uint8_t {name}_order_{'abc'[ch]}[] PROGMEM = {{\n")
+        entries = [str(i) for i in order] + [end]
+        for j in range(0, len(entries), 16):
+            out.write("\t" + ", ".join(entries[j:j+16]) + ",\n")
+        out.write("};\n\n")
+
+    refs = ", ".join(f"{name}_order_{'abc'[ch]}" if o is not None else "NULL"
+                     for ch, o in enumerate(orders))
+    out.write(f"const song_t song_{name} PROGMEM = {{\n"
+              f"\t.tick_ms  = {tick_ms},\n"
+              f"\t.patterns = {name}_patterns,\n"
+              f"\t.orders   = {{{refs}}},\n}};\n")
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Converts a MIDI file into a firmware song")
+    parser.add_argument("midi", help="Standard MIDI File to convert")
+    parser.add_argument("-n", "--name", default="midi",
+                        help="song name, the song is named song_<name>")
+    parser.add_argument("-o", "--output", help="C file to write, or stdout")
+    parser.add_argument("-t", "--tick-ms", type=int, default=20,
+                        help="sequencer tick in ms, 1 to 255 (default 20)")
+    parser.add_argument("-p", "--pattern-ticks", type=int,
+                        help="pattern length in ticks (default one bar)")
+    parser.add_argument("-l", "--loop", action="store_true",
+                        help="loop the song instead of stopping at its end")
+    parser.add_argument("--keep-drums", action="store_true",
+                        help="convert the drums channel as notes, not hits")
+    parser.add_argument("--flash-budget", type=int,
+                        help="fail if the song takes more bytes of flash")
+    parser.add_argument("--events-budget", type=int,
+                        help="fail if a tick reads more events")
+    args = parser.parse_args()
+
+    if not 1 <= args.tick_ms <= 255:
+        parser.error("the tick must be within 1 and 255 ms")
+
+    notes, hits, bar = read_midi(args.midi, args.keep_drums)
+    if not notes and not hits:
+        print("No notes to convert, exiting")
+        sys.exit(1)
+
+    stats = {"notes": len(notes), "cut": 0, "dropped": 0, "transposed": 0,
+             "merged": 0}
+    tick_s = args.tick_ms / 1000
+    pattern_ticks = args.pattern_ticks or max(1, round(bar / tick_s))
+    tracks = reduce_voices(quantise(notes, tick_s), stats)
+    hits = one_hit_per_tick([(round(t / tick_s), piece) for t, piece in hits],
+                            stats)
+    length = max([n.end for t in tracks for n in t] +
+                 [t + 1 for t, _ in hits])
+    length += -length % pattern_ticks
+
+    patterns: List[bytes] = []
+    index: Dict[bytes, int] = {}
+    orders: List[Optional[List[int]]] = []
+    raw_size = 0
+    for i, track in enumerate(tracks):
+        voice_hits = hits if i == 0 else []
+        if not track and not voice_hits:
+            orders.append(None)
+            continue
+        split = split_patterns(voice_events(track, voice_hits, length, stats),
+                               length, pattern_ticks)
+        if not args.loop:
+            # The voice stops after its last note or rest
+            while len(split) > 1 and split[-1] == bytes(
+                    encode_wait(pattern_ticks)) + bytes([song_end]):
+                split.pop()
+        order = []
+        for data in split:
+            raw_size += len(data)
+            if data not in index:
+                index[data] = len(patterns)
+                patterns.append(data)
+            order.append(index[data])
+        orders.append(order)
+
+    if len(patterns) > max_patterns:
+        print(f"Too many patterns ({len(patterns)} > {max_patterns}), "
+              "use longer patterns")
+        sys.exit(1)
+
+    if args.output:
+        with open(args.output, "w") as out:
+            write_song(out, args.name, args.midi.split("/")[-1], args.tick_ms,
+                       args.loop, patterns, orders)
+    else:
+        write_song(sys.stdout, args.name, args.midi.split("/")[-1],
+                   args.tick_ms, args.loop, patterns, orders)
+
+    pattern_bytes = sum(len(p) for p in patterns)
+    order_bytes = sum(len(o) + 1 for o in orders if o is not None)
+    flash = pattern_bytes + 2 * len(patterns) + order_bytes + song_desc_size
+    run = simulate(orders, patterns, args.loop)
+
+    report = sys.stderr if not args.output else sys.stdout
+    print(f"notes:      {stats['notes']} ({stats['cut']} cut, "
+          f"{stats['dropped']} dropped, {stats['transposed']} transposed), "
+          f"{len(hits)} drum hits ({stats['merged']} merged)", file=report)
+    print(f"duration:   {length} ticks, {length * args.tick_ms / 1000:.1f} s, "
+          f"{pattern_ticks} ticks per pattern", file=report)
+    print(f"patterns:   {len(patterns)} unique, {pattern_bytes} bytes "
+          f"({raw_size} bytes before deduplication)", file=report)
+    print(f"flash:      {flash} bytes (patterns {pattern_bytes}, table "
+          f"{2 * len(patterns)}, orders {order_bytes}, descriptor "
+          f"{song_desc_size})", file=report)
+    print(f"events:     peak {run['max_events']} per tick, average "
+          f"{run['events'] / max(run['ticks'], 1):.2f}, "
+          f"{run['deferred']} deferred", file=report)
+
+    failed = False
+    if args.flash_budget is not None and flash > args.flash_budget:
+        print(f"Over the flash budget by {flash - args.flash_budget} bytes",
+              file=report)
+        failed = True
+    if args.events_budget is not None and run["max_events"] > args.events_budget:
+        print(f"Over the events budget by "
+              f"{run['max_events'] - args.events_budget} events", file=report)
+        failed = True
+    sys.exit(1 if failed else 0)
+
+
+if __name__ == "__main__":
+    main()
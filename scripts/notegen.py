@@ -19,6 +19,14 @@ The frequency of a note is given by:
         fn = f_clk / (16 * mask)
         mask = 1/16 * (f_clk / fn), f_clk = 2 MHz
 
+The script also generates the envelope periods used by the buzzer bass,
+where the envelope runs at audio rate. A sawtooth envelope cycle lasts 16
+steps of 16 clock periods each, scaled by the envelope period:
+        fn = f_clk / (256 * env)
+        env = 1/256 * (f_clk / fn)
+The periods are rounded and clamped to 1-255: from the fifth octave on, the
+envelope can no longer follow the note.
+
 
 References:
     - Equations for the Frequency Table:
@@ -42,13 +50,24 @@ def mask(f: float) -> int:
     return int(f_clk // (16 * f))
 
 
+def env(f: float) -> int:
+    return min(max(round(f_clk / (256 * f)), 1), 255)
+
+
+def print_table(decl: str, values: list):
+    print(decl + " = {")
+    print(f"\t{values[0]},")
+    start = 1
+    for i in range(1, len(values), octave):
+        row = [str(e) for e in values[start:start+octave]]
+        print("\t" + ", ".join(row) + ",")
+        start += octave
+    print("};")
+
+
 magic_values = [mask(freq(i)) for i in range(b0_n, b8_n+1)]
+env_values = [env(freq(i)) for i in range(b0_n, b8_n+1)]
 
-print("static const unsigned int magic_notes[] = {")
-print(f"\t{magic_values[0]}")
-start = 1
-for i in range(1, len(magic_values), octave):
-    row = [str(e) for e in magic_values[start:start+octave]]
-    print("\t" + ", ".join(row))
-    start += octave
-print("};")
+print_table("static const unsigned int magic_notes[]", magic_values)
+print()
+print_table("static const uint8_t env_notes[]", env_values)
@@ -0,0 +1,299 @@
+"""
+Register dump compiler, converting YM files into the LZ compressed dumps
+played by the firmware dump player (see inc/dump.h).
+
+A YM file holds the values of the PSG registers sampled at every frame of
+the original player, usually 50 Hz. The supported inputs are:
+    - YM2!, YM3!, YM3b!, YM5! and YM6! files, once extracted from their LHA
+      archive (e.g. with 'lha x song.ym'): most YM files are distributed
+      compressed.
+    - raw dumps (.bin), 14 registers per frame one frame after the other.
+
+The registers are masked to their valid bits and, if the file was captured
+with a different master clock, the tone, noise and envelope periods are
+rescaled to the 2 MHz clock of the synth. The frames are then compressed,
+frame after frame, with an LZ77 coder whose matches never reach further
+back than the decode window of the player. The frames from the loop frame
+on are compressed on their own, so that the player can jump back to them.
+
+Along with the C source of the dump, the tool reports the compressed size
+and, for the worst frame, the number of stream bytes read and of registers
+written, which bound the per frame decode and bus time.
+
+Usage:
+    python3 scripts/ym2dump.py song.ym -n my_dump -o src/my_dump.c
+The dump must then be declared in inc/dump.h and added to the dumps table
+of src/main.c.
+
+References:
+    - YM file format:
+        http://leonard.oxg.free.fr/ymformat.html
+"""
+
+from typing import List, Tuple
+
+import argparse
+import struct
+import sys
+
+
+regs = 14                   # AY38910A_REGS
+psg_clock = 2_000_000       # Clock of the synth PSG (Hz)
+default_window = 256        # DUMP_WINDOW of inc/dump.h
+min_match = 3               # DUMP_MIN_MATCH of inc/dump.h
+max_match = 0x7f + min_match
+max_literals = 0x80
+max_chain = 64              # Match candidates tried per position
+no_write = 0xff             # DUMP_NO_WRITE, shape register not written
+dump_desc_size = 9          # sizeof(dump_t) on AVR
+
+# Valid bits of every register, the YM6 effects live in the unused ones
+reg_masks = [0xff, 0x0f, 0xff, 0x0f, 0xff, 0x0f, 0x1f, 0x3f,
+             0x1f, 0x1f, 0x1f, 0xff, 0xff, 0x0f]
+
+
+class Dump:
+    def __init__(self, frames: List[bytes], rate: int, clock: int, loop: int):
+        self.frames = frames
+        self.rate = rate
+        self.clock = clock
+        self.loop = loop
+
+
+# Input
+
+
+def deinterleave(data: bytes, n_frames: int) -> List[bytes]:
+    return [bytes(data[r * n_frames + f] for r in range(regs))
+            for f in range(n_frames)]
+
+
+def read_ym(data: bytes) -> Dump:
+    if data[2:7] == b"-lh5-":
+        raise ValueError("LHA compressed file, extract it first "
+                         "(e.g. 'lha x song.ym')")
+    tag = data[:4]
+    if tag in (b"YM2!", b"YM3!", b"YM3b"):
+        body = data[4:]
+        loop = 0
+        if tag == b"YM3b":
+            loop = struct.unpack("<I", body[-4:])[0]
+            body = body[:-4]
+        n_frames = len(body) // regs
+        return Dump(deinterleave(body, n_frames), 50, 2_000_000, loop)
+
+    if tag not in (b"YM5!", b"YM6!"):
+        raise ValueError(f"unsupported file tag {tag!r}")
+    (n_frames, attributes, n_drums, clock, rate, loop,
+     extra) = struct.unpack(">IIHIHIH", data[12:34])
+    pos = 34 + extra
+    for _ in range(n_drums):
+        size = struct.unpack(">I", data[pos:pos+4])[0]
+        pos += 4 + size
+    for _ in range(3):  # Song name, author and comment
+        pos = data.index(b"\0", pos) + 1
+    body = data[pos:pos + n_frames * 16]
+    if attributes & 0x01:
+        frames = deinterleave(body, n_frames)
+    else:
+        frames = [body[f * 16:f * 16 + regs] for f in range(n_frames)]
+    return Dump(frames, rate, clock, loop)
+
+
+def read_raw(data: bytes, rate: int) -> Dump:
+    n_frames = len(data) // regs
+    return Dump([data[f * regs:(f + 1) * regs] for f in range(n_frames)],
+                rate, psg_clock, 0)
+
+
+def rescale(period: int, clock: int, limit: int) -> int:
+    return min(round(period * psg_clock / clock), limit)
+
+
+def clean(dump: Dump) -> List[bytes]:
+    """Masks the registers and rescales the periods to the synth clock."""
+    ret = []
+    for frame in dump.frames:
+        r = [frame[i] & reg_masks[i] for i in range(regs)]
+        if frame[13] == no_write:
+            r[13] = no_write
+        if dump.clock != psg_clock:
+            for ch in range(3):
+                p = rescale(r[2*ch] | r[2*ch+1] << 8, dump.clock, 0xfff)
+                r[2*ch], r[2*ch+1] = p & 0xff, p >> 8
+            r[6] = rescale(r[6], dump.clock, 0x1f)
+            p = rescale(r[11] | r[12] << 8, dump.clock, 0xffff)
+            r[11], r[12] = p & 0xff, p >> 8
+        ret.append(bytes(r))
+    return ret
+
+
+# Compression
+
+
+def compress(data: bytes, window: int) -> bytes:
+    """LZ77 coder, greedy with hash chains, in the dump.h token format."""
+    out = bytearray()
+    literals = bytearray()
+    chains = {}
+
+    def flush():
+        while literals:
+            run = literals[:max_literals]
+            out.append(len(run) - 1)
+            out.extend(run)
+            del literals[:max_literals]
+
+    pos = 0
+    while pos < len(data):
+        best_len, best_dist = 0, 0
+        key = data[pos:pos + min_match]
+        for cand in reversed(chains.get(key, [])[-max_chain:]):
+            dist = pos - cand
+            if dist > window:
+                break
+            length = 0
+            # Matches may overlap the bytes they produce
+            while (length < max_match and pos + length < len(data)
+                   and data[cand + length] == data[pos + length]):
+                length += 1
+            if length > best_len:
+                best_len, best_dist = length, dist
+                if length == max_match:
+                    break
+
+        step = best_len if best_len >= min_match else 1
+        for i in range(pos, pos + step):
+            if i + min_match <= len(data):
+                chains.setdefault(data[i:i + min_match], []).append(i)
+        if best_len >= min_match:
+            flush()
+            out.append(0x80 | (best_len - min_match))
+            out.extend(struct.pack("<H", best_dist))
+        else:
+            literals.append(data[pos])
+        pos += step
+    flush()
+    return bytes(out)
+
+
+def frame_costs(stream: bytes, n_frames: int) -> Tuple[int, int]:
+    """Returns the most stream bytes and tokens read by a single frame."""
+    max_bytes = max_tokens = 0
+    pos = left = 0
+    match = False
+    for _ in range(n_frames):
+        start, tokens = pos, 0
+        for _ in range(regs):
+            if left == 0:
+                tok = stream[pos]
+                pos += 1
+                tokens += 1
+                match = bool(tok & 0x80)
+                if match:
+                    left = (tok & 0x7f) + min_match
+                    pos += 2
+                else:
+                    left = tok + 1
+            if not match:
+                pos += 1
+            left -= 1
+        max_bytes = max(max_bytes, pos - start)
+        max_tokens = max(max_tokens, tokens)
+    return max_bytes, max_tokens
+
+
+def max_writes(frames: List[bytes]) -> int:
+    worst = regs  # The first frame writes every register
+    for prev, frame in zip(frames, frames[1:]):
+        n = sum(1 for i in range(regs - 1) if frame[i] != prev[i])
+        worst = max(worst, n + (frame[regs - 1] != no_write))
+    return worst
+
+
+# Output
+
+
+def write_dump(out, name: str, source: str, frame_ms: int, window: int,
+               n_frames: int, loop: int, loop_at: int, stream: bytes):
+    out.write('#include "dump.h"\n\n#include <avr/pgmspace.h>\n\n')
+    out.write(f"/**\n * Generated by scripts/ym2dump.py from {source},\n"
+              f" * {n_frames} frames of {frame_ms} ms, {len(stream)} bytes.\n"
+              " */\n\n")
+    out.write(f"static const uint8_t {name}_data[] PROGMEM = {{\n")
+    for i in range(0, len(stream), 12):
+        out.write("\t" + ", ".join(f"0x{b:02x}" for b in stream[i:i+12])
+                  + ",\n")
+    out.write("};\n\n")
+    out.write(f"const dump_t dump_{name} PROGMEM = {{\n"
+              f"\t.frame_ms = {frame_ms},\n"
+              f"\t.window   = {window},\n"
+              f"\t.frames   = {n_frames},\n"
+              f"\t.loop     = {loop},\n"
+              f"\t.loop_at  = {loop_at},\n"
+              f"\t.data     = {name}_data,\n}};\n")
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Converts a YM file into a firmware register dump")
+    parser.add_argument("ym", help="YM file, or raw dump (.bin)")
+    parser.add_argument("-n", "--name", default="ym",
+                        help="dump name, the dump is named dump_<name>")
+    parser.add_argument("-o", "--output", help="C file to write, or stdout")
+    parser.add_argument("-w", "--window", type=int, default=default_window,
+                        help="decode window in bytes (default 256)")
+    parser.add_argument("-r", "--rate", type=int, default=50,
+                        help="frame rate of raw dumps in Hz (default 50)")
+    parser.add_argument("-f", "--frames", type=int,
+                        help="only convert the first frames")
+    parser.add_argument("--no-loop", action="store_true",
+                        help="stop at the end instead of looping")
+    args = parser.parse_args()
+
+    with open(args.ym, "rb") as f:
+        data = f.read()
+    if args.ym.endswith(".bin"):
+        dump = read_raw(data, args.rate)
+    else:
+        dump = read_ym(data)
+
+    frames = clean(dump)[:args.frames]
+    n_frames = len(frames)
+    if not n_frames or n_frames > 0xffff:
+        print(f"Unsupported number of frames ({n_frames}), exiting")
+        sys.exit(1)
+    frame_ms = round(1000 / dump.rate)
+    if not 1 <= frame_ms <= 255:
+        print(f"Unsupported frame rate ({dump.rate} Hz), exiting")
+        sys.exit(1)
+
+    loop = n_frames if args.no_loop or dump.loop >= n_frames else dump.loop
+    intro = compress(b"".join(frames[:loop]), args.window)
+    body = compress(b"".join(frames[loop:]), args.window)
+    stream = intro + body
+
+    source = args.ym.split("/")[-1]
+    if args.output:
+        with open(args.output, "w") as out:
+            write_dump(out, args.name, source, frame_ms, args.window,
+                       n_frames, loop, len(intro), stream)
+    else:
+        write_dump(sys.stdout, args.name, source, frame_ms, args.window,
+                   n_frames, loop, len(intro), stream)
+
+    raw = n_frames * regs
+    worst_bytes, worst_tokens = frame_costs(stream, n_frames)
+    report = sys.stderr if not args.output else sys.stdout
+    print(f"frames:  {n_frames} at {dump.rate} Hz, "
+          f"{n_frames * frame_ms / 1000:.1f} s, loop to {loop}", file=report)
+    print(f"flash:   {len(stream) + dump_desc_size} bytes, stream "
+          f"{len(stream)} of {raw} ({100 * len(stream) / raw:.1f} %)",
+          file=report)
+    print(f"sram:    {args.window} bytes of window", file=report)
+    print(f"worst:   {worst_bytes} stream bytes, {worst_tokens} tokens, "
+          f"{max_writes(frames)} register writes in a frame", file=report)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,166 @@
+/************************************************************************/
+/* Includes                                                             */
+/************************************************************************/
+
+#include "adc.h"
+
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+
+/************************************************************************/
+/* Defines                                                              */
+/************************************************************************/
+
+/**
+ * Timer1 runs in CTC mode with a /8 prescaler, the compare match B
+ * fires when the counter reaches the top value:
+ *   OCR1A = F_CPU / 8 / f_trigger - 1
+ */
+#define TRIGGER_PRESCALER (8)
+#define TRIGGER_TOP       (F_CPU / TRIGGER_PRESCALER / ADC_TRIGGER_HZ - 1)
+
+#if (1 << (2 * ADC_EXTRA_BITS)) != ADC_OVERSAMPLE || ADC_OVERSAMPLE > 64
+#error ADC_OVERSAMPLE must be 4^ADC_EXTRA_BITS, and at most 64
+#endif
+
+/************************************************************************/
+/* Private function declarations                                        */
+/************************************************************************/
+
+static void select_channel(uint8_t pot);
+static void publish(uint8_t pot, uint16_t value);
+
+/************************************************************************/
+/* Private variables                                                    */
+/************************************************************************/
+
+/**
+ * ADC input each potentiometer is wired to, only ADC0-7 are supported.
+ */
+static const uint8_t adc_channel_mux[ADC_CHANNELS] PROGMEM = {
+	[ADC_POT_MENU]       = 0,
+	[ADC_POT_ENV_PERIOD] = 1,
+	[ADC_POT_DETUNE]     = 2,
+	[ADC_POT_LFO_RATE]   = 3,
+};
+
+static volatile uint16_t values[ADC_CHANNELS] = {0};
+static volatile uint8_t  changed              =  0;
+static volatile bool     held                 =  false;
+
+// Scan state, only touched by the ADC interrupt
+static uint8_t  cur_pot = 0;
+static uint8_t  count   = 0;
+static uint16_t acc     = 0;
+
+/************************************************************************/
+/* Function implementations                                             */
+/************************************************************************/
+
+void adc_init(void) {
+	uint8_t didr = 0;
+	for(uint8_t i = 0; i < ADC_CHANNELS; i++) {
+		didr |= (1 << pgm_read_byte(&adc_channel_mux[i]));
+	}
+	DIDR0 = didr; // Digital input buffers are useless on analog pins
+
+	select_channel(0);
+	ADCSRB = (1 << ADTS2) | (1 << ADTS0);   // Trigger: Timer1 compare match B
+	ADCSRA = (1 << ADEN)  | (1 << ADATE) |  // Auto-triggered
+					 (1 << ADIE)  |                 // Interrupt mode
+					 (1 << ADPS2) | (1 << ADPS1) | (1 << ADPS0); // 128-prescaling
+
+	OCR1A  = TRIGGER_TOP;
+	OCR1B  = TRIGGER_TOP;
+	TCCR1A = 0;
+	TCCR1B = (1 << WGM12) | (1 << CS11);    // CTC, /8 prescaler
+}
+
+uint16_t adc_get(adc_pot_t pot) {
+	uint16_t value;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		value = values[pot];
+	}
+	return value;
+}
+
+void adc_snapshot(uint16_t out[ADC_CHANNELS]) {
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		for(uint8_t i = 0; i < ADC_CHANNELS; i++) {
+			out[i] = values[i];
+		}
+	}
+}
+
+uint8_t adc_changed(void) {
+	uint8_t ret;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		ret = changed;
+		changed = 0;
+	}
+	return ret;
+}
+
+void adc_hold(bool hold) {
+	held = hold;
+}
+
+void adc_set(adc_pot_t pot, uint16_t value) {
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		values[pot] = value;
+		changed |= (1 << pot);
+	}
+}
+
+/************************************************************************/
+/* Private Helpers                                                      */
+/************************************************************************/
+
+/**
+ * Points the mux to the input of the passed potentiometer. The change is
+ * picked up by the next triggered conversion.
+ */
+static void select_channel(uint8_t pot) {
+	ADMUX = (1 << REFS1) | (1 << REFS0) |   // Internal ref
+	        (pgm_read_byte(&adc_channel_mux[pot]) & 0x07);
+}
+
+/**
+ * Publishes a decimated value if it exceeds the hysteresis band.
+ */
+static void publish(uint8_t pot, uint16_t value) {
+	uint16_t last = values[pot];
+	uint16_t diff = value > last ? value - last : last - value;
+	if(diff > ADC_HYSTERESIS ||
+	   (value != last && (value == 0 || value == ADC_MAX_VALUE))) {
+		values[pot] = value;
+		changed |= (1 << pot);
+	}
+}
+
+ISR(ADC_vect,) {
+	uint16_t sample = ADC;
+
+	// The trigger flag is not cleared by any ISR, do it by hand to arm
+	// the next auto-triggered conversion
+	TIFR1 = (1 << OCF1B);
+
+	if(count++ == 0) {
+		return; // first sample after a mux switch, let it settle
+	}
+
+	acc += sample;
+	if(count <= ADC_OVERSAMPLE) {
+		return;
+	}
+
+	if(!held) {
+		publish(cur_pot, acc >> ADC_EXTRA_BITS);
+	}
+	acc     = 0;
+	count   = 0;
+	cur_pot = (cur_pot + 1) % ADC_CHANNELS;
+	select_channel(cur_pot);
+}
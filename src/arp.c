@@ -0,0 +1,109 @@
+/************************************************************************/
+/* Includes                                                             */
+/************************************************************************/
+
+#include "arp.h"
+#include "drums.h"
+
+#include <stddef.h>
+
+/************************************************************************/
+/* Defines                                                              */
+/************************************************************************/
+
+#define ARP_IDLE_MS 100 // Task period while the pool is not cycling
+
+/************************************************************************/
+/* Private variables                                                    */
+/************************************************************************/
+
+static const ay38910a_t * psg      = NULL;
+static sched_task_t *     arp_task = NULL;
+
+static channel_t arp_chan;
+static uint8_t   ids[ARP_MAX_NOTES];
+static uint8_t   notes[ARP_MAX_NOTES];
+static uint8_t   n_notes = 0;
+static uint8_t   pos     = 0;
+static uint8_t   rate_ms = 1000 / ARP_RATE_DEF;
+
+/************************************************************************/
+/* Function implementations                                             */
+/************************************************************************/
+
+void arp_init(const ay38910a_t * ay, sched_task_t * task) {
+	psg      = ay;
+	arp_task = task;
+	arp_task->period_ms = ARP_IDLE_MS;
+}
+
+void arp_set_rate(uint8_t hz) {
+	if(hz < ARP_RATE_MIN) {
+		hz = ARP_RATE_MIN;
+	} else if(hz > ARP_RATE_MAX) {
+		hz = ARP_RATE_MAX;
+	}
+	rate_ms = 1000 / hz;
+	if(n_notes > 1) {
+		arp_task->period_ms = rate_ms;
+	}
+}
+
+bool arp_add(channel_t chan, uint8_t id, uint8_t note) {
+	if(n_notes == ARP_MAX_NOTES) {
+		return false;
+	}
+	if(n_notes == 0) {
+		arp_chan = chan;
+	}
+	ids[n_notes]   = id;
+	notes[n_notes] = note;
+	if(++n_notes == 2) {
+		arp_task->period_ms = rate_ms;
+		sched_wake(arp_task);
+	}
+	return true;
+}
+
+uint8_t arp_remove(uint8_t id) {
+	for(uint8_t i = 0; i < n_notes; i++) {
+		if(ids[i] != id) {
+			continue;
+		}
+		n_notes--;
+		for(uint8_t j = i; j < n_notes; j++) {
+			ids[j]   = ids[j + 1];
+			notes[j] = notes[j + 1];
+		}
+		if(pos >= n_notes) {
+			pos = 0;
+		}
+		if(n_notes == 1) {
+			// Back to a plain voice, holding the note left
+			arp_task->period_ms = ARP_IDLE_MS;
+			ay38910_play_note(psg, arp_chan, notes[0]);
+		}
+		break;
+	}
+	return n_notes;
+}
+
+bool arp_owns(channel_t chan) {
+	return n_notes > 0 && chan == arp_chan;
+}
+
+void arp_reset(void) {
+	n_notes = 0;
+	pos     = 0;
+	arp_task->period_ms = ARP_IDLE_MS;
+}
+
+void arp_step(void) {
+	if(n_notes < 2 || drums_borrowed(arp_chan)) {
+		return;
+	}
+	if(++pos >= n_notes) {
+		pos = 0;
+	}
+	ay38910_play_note(psg, arp_chan, notes[pos]);
+}
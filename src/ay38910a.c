@@ -7,6 +7,8 @@
 #include "delay.h"
 
 #include <assert.h>
+#include <stddef.h>
+#include <avr/pgmspace.h>
 
 /************************************************************************/
 /* Defines                                                              */
@@ -14,15 +16,15 @@
 
 #define INLINED __attribute__((always_inline)) inline
 
-#define NOISE_REG      0x06
-#define MIXER_REG      0x07
-#define FINE_ENV_REG   0x0B
-#define COARSE_ENV_REG 0x0C
-#define SHAPE_ENV_REG  0x0D
+#define NOISE_REG      AY38910A_REG_NOISE
+#define MIXER_REG      AY38910A_REG_MIXER
+#define FINE_ENV_REG   AY38910A_REG_ENV_FINE
+#define COARSE_ENV_REG AY38910A_REG_ENV_CRS
+#define SHAPE_ENV_REG  AY38910A_REG_ENV_SHP
 
 #define MIXER_MASK     0xC0
 
-#define CHAN_TO_AMP_REG(c) (((uint8_t)c / 2) + 8)
+#define CHAN_TO_AMP_REG(c) (((uint8_t)c / 2) + AY38910A_REG_AMP_A)
 
 /**
  * Setting up the clock signal
@@ -84,8 +86,9 @@ static void oc2a_pin_config(const timer_t * t);
  * The range of notes is from a B0 to a B8 (8 octaves).
  *
  * This array is auto-generated by a script that applies these concepts.
+ * It is kept in flash, read with pgm_read_word.
  */
-static const unsigned int magic_notes[] = {
+static const unsigned int magic_notes[] PROGMEM = {
 	4049,
 	3823, 3607, 3405, 3214, 3034, 2864, 2703, 2551, 2408, 2273, 2145, 2025,
 	1911, 1804, 1703, 1607, 1517, 1432, 1351, 1276, 1204, 1136, 1073, 1012,
@@ -97,6 +100,30 @@ static const unsigned int magic_notes[] = {
 	28, 27, 25, 24, 22, 21, 20, 19, 18, 17, 16,
 };
 
+/**
+ * Envelope periods of the same notes, for the buzzer: a sawtooth envelope
+ * cycle is 16 steps of 16 clock periods each, scaled by the period.
+ *
+ * f_note = f_clk / (256 * env) => env = (f_clk / f_note) / 256
+ *
+ * The periods are clamped to 1-255, they are out of tune above B4.
+ *
+ * This array is generated by the same script as magic_notes.
+ */
+static const uint8_t env_notes[] PROGMEM = {
+	253,
+	239, 225, 213, 201, 190, 179, 169, 159, 150, 142, 134, 127,
+	119, 113, 106, 100, 95, 89, 84, 80, 75, 71, 67, 63,
+	60, 56, 53, 50, 47, 45, 42, 40, 38, 36, 34, 32,
+	30, 28, 27, 25, 24, 22, 21, 20, 19, 18, 17, 16,
+	15, 14, 13, 13, 12, 11, 11, 10, 9, 9, 8, 8,
+	7, 7, 7, 6, 6, 6, 5, 5, 5, 4, 4, 4,
+	4, 4, 3, 3, 3, 3, 3, 2, 2, 2, 2, 2,
+	2, 2, 2, 2, 1, 1, 1, 1, 1, 1, 1, 1,
+};
+
+static void (*write_hook)(uint8_t reg, uint8_t data) = NULL;
+
 /************************************************************************/
 /* Function implementations                                             */
 /************************************************************************/
@@ -111,9 +138,33 @@ void ay38910_init(const ay38910a_t * ay, const timer_t * t)
 
 void ay38910_play_note(const ay38910a_t * ay, channel_t chan, uint8_t note)
 {
-	assert(note <= N_NOTES);
-	write_to_data_bus(ay, (uint8_t)chan, magic_notes[note] & 0xFF);
-	write_to_data_bus(ay, (uint8_t)chan + 1, (magic_notes[note] >> 8) & 0x0F);
+	uint16_t period = ay38910_note_period(note);
+	write_to_data_bus(ay, (uint8_t)chan, period & 0xFF);
+	write_to_data_bus(ay, (uint8_t)chan + 1, (period >> 8) & 0x0F);
+}
+
+uint16_t ay38910_note_period(uint8_t note)
+{
+	assert(note < N_NOTES);
+	return pgm_read_word(&magic_notes[note]);
+}
+
+void ay38910_play_buzzer(const ay38910a_t * ay, channel_t chan, uint8_t shape,
+                         uint8_t note)
+{
+	assert(note < N_NOTES);
+	uint8_t  env  = pgm_read_byte(&env_notes[note]);
+	uint16_t tone = env << 4;
+	if(shape & FUNC_ALTERNATE) {
+		// Up and down: the cycle is two ramps long
+		env  = (env + 1) >> 1;
+		tone = env << 5;
+	}
+	write_to_data_bus(ay, (uint8_t)chan, tone & 0xFF);
+	write_to_data_bus(ay, (uint8_t)chan + 1, (tone >> 8) & 0x0F);
+	write_to_data_bus(ay, FINE_ENV_REG, env);
+	write_to_data_bus(ay, COARSE_ENV_REG, 0);
+	write_to_data_bus(ay, SHAPE_ENV_REG, shape & 0x0F);
 }
 
 void ay38910_play_noise(const ay38910a_t * ay, uint8_t divider)
@@ -138,6 +189,33 @@ void ay38910_set_envelope(const ay38910a_t * ay, uint8_t shape, uint16_t freq)
 	write_to_data_bus(ay, SHAPE_ENV_REG, shape & 0x0F);
 }
 
+void ay38910_set_envelope_period(const ay38910a_t * ay, uint16_t freq)
+{
+	write_to_data_bus(ay, FINE_ENV_REG, freq & 0xFF);
+	write_to_data_bus(ay, COARSE_ENV_REG, (freq >> 8) & 0xFF);
+}
+
+void ay38910_write_reg(const ay38910a_t * ay, uint8_t reg, uint8_t data)
+{
+	if(reg == MIXER_REG) {
+		data |= MIXER_MASK;
+	}
+	write_to_data_bus(ay, reg, data);
+}
+
+void ay38910_on_write(void (*hook)(uint8_t reg, uint8_t data))
+{
+	write_hook = hook;
+}
+
+uint8_t ay38910_read_shadow(const ay38910a_t * ay, uint8_t reg)
+{
+	if(ay->regs == NULL || reg >= AY38910A_REGS) {
+		return 0;
+	}
+	return ay->regs[reg];
+}
+
 /************************************************************************/
 /* Private Helpers                                                      */
 /************************************************************************/
@@ -197,6 +275,13 @@ void write_to_data_bus(const ay38910a_t  * ay, uint8_t address, uint8_t data)
 	write_mode(ay);
 	set_port(ay->bus_port, data);
 	inactive_mode(ay);
+
+	if(ay->regs != NULL && address < AY38910A_REGS) {
+		ay->regs[address] = data;
+	}
+	if(write_hook != NULL) {
+		write_hook(address, data);
+	}
 }
 
 
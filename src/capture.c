@@ -0,0 +1,252 @@
+/************************************************************************/
+/* Includes                                                             */
+/************************************************************************/
+
+#include "capture.h"
+#include "clock.h"
+#include "settings.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/************************************************************************/
+/* Defines                                                              */
+/************************************************************************/
+
+#define RING_MASK   (CAPTURE_RING - 1)
+#define HEADER_SIZE (2 + AY38910A_REGS)
+
+#define LOST_MARK   0xff // Ring entry standing for lost writes
+#define TICK_MARK   0xfe // Ring entry only moving the clock
+#define CODE_WAIT   0x80
+#define CODE_WAIT16 0xfe
+#define CODE_LOST   0xff
+#define WAIT_MAX    (CODE_WAIT16 - CODE_WAIT - 1)
+
+/************************************************************************/
+/* Typedefs                                                             */
+/************************************************************************/
+
+typedef struct entry_t {
+	uint16_t ms;   /**< Low bits of the clock at the write */
+	uint8_t  reg;  /**< Register, or LOST_MARK             */
+	uint8_t  data; /**< Value, or the count of lost writes */
+} entry_t;
+
+/************************************************************************/
+/* Private function declarations                                        */
+/************************************************************************/
+
+static void on_write(uint8_t reg, uint8_t data);
+static void push(uint32_t ms, uint8_t reg, uint8_t data);
+static void keepalive(void);
+static void start(void);
+static void encode(const entry_t * e);
+
+/************************************************************************/
+/* Private variables                                                    */
+/************************************************************************/
+
+static const ay38910a_t * psg          = NULL;
+static sched_task_t *     capture_task = NULL;
+
+static entry_t  ring[CAPTURE_RING];
+static uint16_t head  = 0;
+static uint16_t count = 0;
+static uint8_t  lost  = 0; // Writes lost since the ring was last full
+static uint32_t last_push; // Time of the last entry
+static uint8_t  mode  = CAPTURE_OFF;
+
+// Encoder state, on the sending side
+static uint8_t  last[AY38910A_REGS];
+static uint16_t last_ms;
+static uint8_t  out[HEADER_SIZE];
+static uint8_t  out_len = 0;
+static uint8_t  out_pos = 0;
+
+static capture_stats_t stats = {0};
+
+/************************************************************************/
+/* Function implementations                                             */
+/************************************************************************/
+
+void capture_init(const ay38910a_t * ay, sched_task_t * task) {
+	psg          = ay;
+	capture_task = task;
+	capture_task->period_ms = CAPTURE_IDLE_MS;
+}
+
+void capture_mode(uint8_t m) {
+	switch(m) {
+	case CAPTURE_LIVE:
+	case CAPTURE_RECORD:
+		start();
+		ay38910_on_write(on_write);
+		capture_task->period_ms = m == CAPTURE_LIVE ? CAPTURE_TX_MS
+		                                            : CAPTURE_IDLE_MS;
+		stg_mute(STG_MUTE_CAPTURE, m == CAPTURE_LIVE);
+		break;
+	case CAPTURE_SEND:
+		if(mode != CAPTURE_RECORD) {
+			return;
+		}
+		ay38910_on_write(NULL);
+		capture_task->period_ms = CAPTURE_TX_MS;
+		stg_mute(STG_MUTE_CAPTURE, true);
+		break;
+	default:
+		ay38910_on_write(NULL);
+		count   = 0;
+		out_len = 0;
+		capture_task->period_ms = CAPTURE_IDLE_MS;
+		stg_mute(STG_MUTE_CAPTURE, false);
+		m = CAPTURE_OFF;
+		break;
+	}
+	mode = m;
+	sched_wake(capture_task);
+}
+
+void capture_send(void) {
+	if(mode == CAPTURE_LIVE || mode == CAPTURE_RECORD) {
+		keepalive();
+	}
+	if(mode != CAPTURE_LIVE && mode != CAPTURE_SEND) {
+		return;
+	}
+
+	for(;;) {
+		if(out_pos == out_len) {
+			out_pos = out_len = 0;
+			// Unchanged writes encode to nothing, move on to the next one
+			while(out_len == 0 && count > 0) {
+				encode(&ring[(head - count) & RING_MASK]);
+				count--;
+			}
+			if(out_len == 0) {
+				break;
+			}
+		}
+		if(!stg_try_put(out[out_pos])) {
+			return;
+		}
+		out_pos++;
+		stats.bytes++;
+	}
+
+	if(mode == CAPTURE_SEND) {
+		capture_mode(CAPTURE_OFF);
+	}
+}
+
+void capture_stats(capture_stats_t * st) {
+	*st = stats;
+}
+
+/************************************************************************/
+/* Private Helpers                                                      */
+/************************************************************************/
+
+/**
+ * Driver hook, stores the write as is: everything else is done when the
+ * write is sent.
+ */
+static void on_write(uint8_t reg, uint8_t data) {
+	if(reg >= AY38910A_REGS) {
+		return; // I/O ports
+	}
+	uint32_t ms = clock_millis();
+	if(lost > 0) {
+		// The mark and the write need two entries
+		if(count > CAPTURE_RING - 2) {
+			if(lost < UINT8_MAX) {
+				lost++;
+			}
+			stats.lost++;
+			return;
+		}
+		push(ms, LOST_MARK, lost);
+		lost = 0;
+	} else if(count == CAPTURE_RING) {
+		lost = 1;
+		stats.lost++;
+		return;
+	}
+	push(ms, reg, data);
+	stats.writes++;
+}
+
+static void push(uint32_t ms, uint8_t reg, uint8_t data) {
+	last_push  = ms;
+	ring[head] = (entry_t){(uint16_t)ms, reg, data};
+	head = (head + 1) & RING_MASK;
+	count++;
+}
+
+/**
+ * Queues an empty entry after a long pause, or the pending lost mark, so
+ * that the ring timestamps never wrap between two entries.
+ */
+static void keepalive(void) {
+	uint32_t now = clock_millis();
+	if(now - last_push < CAPTURE_KEEPALIVE_MS || count > CAPTURE_RING - 2) {
+		return;
+	}
+	if(lost > 0) {
+		push(now, LOST_MARK, lost);
+		lost = 0;
+	} else {
+		push(now, TICK_MARK, 0);
+	}
+}
+
+/**
+ * Empties the ring and queues the header, with the registers as they are.
+ */
+static void start(void) {
+	count   = 0;
+	lost    = 0;
+	last_push = clock_millis();
+	last_ms   = (uint16_t)last_push;
+
+	out[0] = 'A';
+	out[1] = 'Y';
+	for(uint8_t r = 0; r < AY38910A_REGS; r++) {
+		last[r]    = ay38910_read_shadow(psg, r);
+		out[2 + r] = last[r];
+	}
+	out_len = HEADER_SIZE;
+	out_pos = 0;
+}
+
+/**
+ * Encodes a ring entry into the output buffer, nothing if the entry does
+ * not change its register.
+ */
+static void encode(const entry_t * e) {
+	if(e->reg < AY38910A_REGS && e->reg != AY38910A_REG_ENV_SHP &&
+	   e->data == last[e->reg]) {
+		stats.skipped++;
+		return;
+	}
+
+	uint16_t dt = e->ms - last_ms;
+	last_ms = e->ms;
+	if(dt > WAIT_MAX) {
+		out[out_len++] = CODE_WAIT16;
+		out[out_len++] = dt & 0xff;
+		out[out_len++] = dt >> 8;
+	} else if(dt > 0) {
+		out[out_len++] = CODE_WAIT | dt;
+	}
+
+	if(e->reg == TICK_MARK) {
+		return;
+	} else if(e->reg == LOST_MARK) {
+		out[out_len++] = CODE_LOST;
+	} else {
+		last[e->reg]   = e->data;
+		out[out_len++] = e->reg;
+	}
+	out[out_len++] = e->data;
+}
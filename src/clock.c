@@ -0,0 +1,92 @@
+/************************************************************************/
+/* Includes                                                             */
+/************************************************************************/
+
+#include "clock.h"
+
+#include <stddef.h>
+#include <util/atomic.h>
+
+/************************************************************************/
+/* Defines                                                              */
+/************************************************************************/
+
+// The period must fit the 8-bit counter, /256 is only needed above 16MHz
+#if F_CPU / 64 / 1000 <= 256
+#define PRESCALER      (64)
+#define CLOCK_TCCR_B   (0x03) // /64 prescaler
+#else
+#define PRESCALER      (256)
+#define CLOCK_TCCR_B   (0x04) // /256 prescaler
+#endif
+
+#define TICKS_PER_MS   (F_CPU / PRESCALER / 1000)
+#define TICKS_FRAC     (F_CPU / PRESCALER % 1000) // 1/1000 of a tick
+#define CLOCK_TCCR_A   (0x02) // CTC mode
+#define CLOCK_TIMSK    (0x02) // Compare match A interrupt
+#define CLOCK_OCF      (0x02) // Compare match A flag
+
+#if TICKS_PER_MS > 256 || TICKS_PER_MS < 2
+#error "F_CPU out of range for an 8-bit millisecond timer"
+#endif
+
+/************************************************************************/
+/* Private variables                                                    */
+/************************************************************************/
+
+static const timer_t *   clock_timer = NULL;
+static volatile uint32_t millis      = 0;
+#if TICKS_FRAC != 0
+static uint16_t          frac        = 0;
+#endif
+
+/************************************************************************/
+/* Function implementations                                             */
+/************************************************************************/
+
+void clock_init(const timer_t * t) {
+	clock_timer = t;
+
+	*t->ocr_a_8 = TICKS_PER_MS - 1;
+	*t->tccr_a  = CLOCK_TCCR_A;
+	*t->tccr_b  = CLOCK_TCCR_B;
+	*t->tim_sk  = CLOCK_TIMSK;
+}
+
+void clock_tick(void) {
+	millis++;
+#if TICKS_FRAC != 0
+	// The period is not a whole number of ticks (e.g. 78.125 at 20MHz),
+	// stretch one period every now and then so that it averages to 1 ms.
+	// The new top applies to the period that just started.
+	frac += TICKS_FRAC;
+	if(frac >= 1000) {
+		frac -= 1000;
+		*clock_timer->ocr_a_8 = TICKS_PER_MS;
+	} else {
+		*clock_timer->ocr_a_8 = TICKS_PER_MS - 1;
+	}
+#endif
+}
+
+uint32_t clock_millis(void) {
+	uint32_t ms;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		ms = millis;
+	}
+	return ms;
+}
+
+uint32_t clock_micros(void) {
+	uint32_t ms;
+	uint8_t  cnt;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		ms  = millis;
+		cnt = *clock_timer->tcnt_8;
+		// The counter already wrapped but the ISR did not run yet
+		if((*clock_timer->tif_r & CLOCK_OCF) && cnt < TICKS_PER_MS / 2) {
+			ms++;
+		}
+	}
+	return ms * 1000 + (uint32_t)cnt * PRESCALER / (F_CPU / 1000000UL);
+}
@@ -0,0 +1,287 @@
+/************************************************************************/
+/* Includes                                                             */
+/************************************************************************/
+
+#include "diag.h"
+#include "lcd_1602a.h"
+#include "meter.h"
+#include "sched.h"
+#include "keys.h"
+#include "seq.h"
+#include "dump.h"
+#include "mod.h"
+#include "drums.h"
+#include "patch.h"
+#include "capture.h"
+#include "input.h"
+#include "mem.h"
+#include "fmt.h"
+#include "settings.h"
+
+#include <util/atomic.h>
+#include <avr/pgmspace.h>
+
+/************************************************************************/
+/* Defines                                                              */
+/************************************************************************/
+
+#define LINE_SIZE (40)
+
+#if defined(UI_SNPRINTF)
+#define UI_SNPRINTF_BUILD (1)
+#else
+#define UI_SNPRINTF_BUILD (0)
+#endif
+
+/************************************************************************/
+/* Private function declarations                                        */
+/************************************************************************/
+
+static void write_value(diag_write_t write, const char * name, uint32_t v);
+static void write_label(diag_write_t write, const char * label, uint32_t v);
+static void write_task_value(diag_write_t write, const char * task,
+                             const char * name, uint32_t v);
+static uint16_t permille(uint32_t part, uint32_t total);
+static uint32_t cycles_per(uint32_t us, uint32_t count);
+
+/************************************************************************/
+/* Private variables                                                    */
+/************************************************************************/
+
+static volatile uint32_t values[DIAG_VALUES] = {0};
+
+// The names are only read by the reports, they are kept in flash
+static const char keys_ready_name[] PROGMEM = "keys_ready_us";
+static const char first_note_name[] PROGMEM = "first_note_us";
+static const char lcd_ready_name[]  PROGMEM = "lcd_ready_us";
+
+static const char * const value_names[DIAG_VALUES] PROGMEM = {
+	[DIAG_BOOT_KEYS_READY] = keys_ready_name,
+	[DIAG_BOOT_FIRST_NOTE] = first_note_name,
+	[DIAG_BOOT_LCD_READY]  = lcd_ready_name,
+};
+
+/************************************************************************/
+/* Function implementations                                             */
+/************************************************************************/
+
+void diag_set_once(diag_value_t value, uint32_t v) {
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		if(values[value] == 0) {
+			values[value] = v;
+		}
+	}
+}
+
+uint32_t diag_get(diag_value_t value) {
+	uint32_t v;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		v = values[value];
+	}
+	return v;
+}
+
+void diag_report(char section, diag_write_t write) {
+	switch(section) {
+	case DIAG_SECTION_BOOT:
+		for(uint8_t i = DIAG_BOOT_KEYS_READY; i <= DIAG_BOOT_LCD_READY; i++) {
+			write_value(write, (const char *)pgm_read_word(&value_names[i]),
+			            diag_get(i));
+		}
+		break;
+	case DIAG_SECTION_LCD: {
+		lcd1602a_stats_t st;
+		lcd1602a_stats(&st);
+		write_value(write, PSTR("depth"), st.depth);
+		write_value(write, PSTR("max_depth"), st.max_depth);
+		write_value(write, PSTR("stalls"), st.stalls);
+		write_value(write, PSTR("sent"), st.sent);
+		break;
+	}
+	case DIAG_SECTION_METER: {
+		meter_stats_t st;
+		meter_stats(&st);
+		write_value(write, PSTR("frames"), st.frames);
+		write_value(write, PSTR("cells"), st.cells);
+		write_value(write, PSTR("max_cells"), st.max_cells);
+		break;
+	}
+	case DIAG_SECTION_KEYS: {
+		keys_stats_t st;
+		keys_stats(&st);
+		write_value(write, PSTR("presses"), st.presses);
+		write_value(write, PSTR("glitches"), st.glitches);
+		write_value(write, PSTR("last_us"), st.last_us);
+		write_value(write, PSTR("max_us"), st.max_us);
+		write_value(write, PSTR("avg_us"), st.presses ? st.total_us / st.presses : 0);
+		break;
+	}
+	case DIAG_SECTION_SEQ: {
+		seq_stats_t st;
+		seq_stats(&st);
+		write_value(write, PSTR("playing"), seq_playing());
+		write_value(write, PSTR("ticks"), st.ticks);
+		write_value(write, PSTR("events"), st.events);
+		write_value(write, PSTR("max_events"), st.max_events);
+		write_value(write, PSTR("deferred"), st.deferred);
+		break;
+	}
+	case DIAG_SECTION_DUMP: {
+		dump_stats_t st;
+		dump_stats(&st);
+		write_value(write, PSTR("playing"), dump_playing());
+		write_value(write, PSTR("frames"), st.frames);
+		write_value(write, PSTR("writes"), st.writes);
+		write_value(write, PSTR("decode_us"), st.decode_us);
+		write_value(write, PSTR("max_decode_us"), st.max_decode_us);
+		write_value(write, PSTR("max_frame_us"), st.max_frame_us);
+		break;
+	}
+	case DIAG_SECTION_MOD: {
+		mod_stats_t st;
+		mod_stats(&st);
+		write_value(write, PSTR("ticks"), st.ticks);
+		write_value(write, PSTR("writes"), st.writes);
+		write_value(write, PSTR("max_us"), st.max_us);
+		write_value(write, PSTR("avg_us"), st.ticks ? st.total_us / st.ticks : 0);
+		write_value(write, PSTR("chan_cycles"),
+		            cycles_per(st.total_us, st.chan_ticks));
+		break;
+	}
+	case DIAG_SECTION_DRUMS: {
+		drums_stats_t st;
+		drums_stats(&st);
+		write_value(write, PSTR("hits"), st.hits);
+		write_value(write, PSTR("steals"), st.steals);
+		write_value(write, PSTR("cuts"), st.cuts);
+		write_value(write, PSTR("max_us"), st.max_us);
+		break;
+	}
+	case DIAG_SECTION_PATCH: {
+		patch_stats_t st;
+		patch_stats(&st);
+		write_value(write, PSTR("applies"), st.applies);
+		write_value(write, PSTR("writes"), st.writes);
+		write_value(write, PSTR("max_us"), st.max_us);
+		break;
+	}
+	case DIAG_SECTION_CAPT: {
+		capture_stats_t st;
+		capture_stats(&st);
+		write_value(write, PSTR("writes"), st.writes);
+		write_value(write, PSTR("lost"), st.lost);
+		write_value(write, PSTR("skipped"), st.skipped);
+		write_value(write, PSTR("bytes"), st.bytes);
+		break;
+	}
+	case DIAG_SECTION_INPUT: {
+		input_stats_t st;
+		input_stats(&st);
+		write_value(write, PSTR("recorded"), st.recorded);
+		write_value(write, PSTR("lost"), st.lost);
+		write_value(write, PSTR("replayed"), st.replayed);
+		write_value(write, PSTR("late_ms"), st.late_ms);
+		break;
+	}
+	case DIAG_SECTION_MEM: {
+		mem_stats_t st;
+		mem_stats(&st);
+		write_value(write, PSTR("static"), st.static_bytes);
+		write_value(write, PSTR("heap"), st.heap_bytes);
+		write_value(write, PSTR("stack"), st.stack_bytes);
+		write_value(write, PSTR("stack_max"), st.stack_max);
+		write_value(write, PSTR("free"), st.free_bytes);
+		write_value(write, PSTR("free_min"), st.free_min);
+		break;
+	}
+	case DIAG_SECTION_FMT: {
+		stg_fmt_stats_t st;
+		stg_fmt_stats(&st);
+		write_value(write, PSTR("snprintf"), UI_SNPRINTF_BUILD);
+		write_value(write, PSTR("calls"), st.calls);
+		write_value(write, PSTR("last_us"), st.last_us);
+		write_value(write, PSTR("max_us"), st.max_us);
+		write_value(write, PSTR("avg_us"), st.calls ? st.total_us / st.calls : 0);
+		break;
+	}
+	case DIAG_SECTION_TASKS: {
+		for(uint8_t i = 0; i < sched_tasks(); i++) {
+			const sched_task_t * t = sched_task(i);
+			write_task_value(write, t->name, PSTR("runs"), t->stats.runs);
+			write_task_value(write, t->name, PSTR("total_us"), t->stats.total_us);
+			write_task_value(write, t->name, PSTR("max_us"), t->stats.max_us);
+			write_task_value(write, t->name, PSTR("missed"), t->stats.missed);
+			write_task_value(write, t->name, PSTR("latency_us"),
+			                 t->stats.max_latency_us);
+		}
+		sched_idle_t idle;
+		sched_idle(&idle);
+		write_value(write, PSTR("idle.sleeps"), idle.sleeps);
+		write_value(write, PSTR("idle.us"), idle.idle_us);
+		write_value(write, PSTR("idle.permille"), permille(idle.idle_us,
+		                                             idle.total_us));
+		break;
+	}
+	default:
+		break;
+	}
+	write("\n");
+}
+
+/************************************************************************/
+/* Private Helpers                                                      */
+/************************************************************************/
+
+/**
+ * Writes a value named by a string in flash.
+ */
+static void write_value(diag_write_t write, const char * name, uint32_t v) {
+	char label[LINE_SIZE / 2];
+	fmt_str_P(label, name, 0);
+	write_label(write, label, v);
+}
+
+/**
+ * Writes a task value, the task name in SRAM and the value name in flash.
+ */
+static void write_task_value(diag_write_t write, const char * task,
+                             const char * name, uint32_t v) {
+	char label[LINE_SIZE / 2];
+	char * p = fmt_str(label, task, 0);
+	*p++ = '.';
+	fmt_str_P(p, name, 0);
+	write_label(write, label, v);
+}
+
+static void write_label(diag_write_t write, const char * label, uint32_t v) {
+	char line[LINE_SIZE];
+	char * p = fmt_str(line, label, 0);
+	*p++ = '=';
+	p = fmt_udec32(p, v);
+	*p++ = '\n';
+	*p   = '\0';
+	write(line);
+}
+
+static uint16_t permille(uint32_t part, uint32_t total) {
+	// Scale both down first, so that part * 1000 cannot overflow
+	while(part > UINT32_MAX / 1000) {
+		part  >>= 1;
+		total >>= 1;
+	}
+	return total == 0 ? 0 : (uint16_t)(part * 1000 / total);
+}
+
+/**
+ * Average cost in cpu cycles, scaled before dividing: a cost of a few us
+ * would otherwise be truncated to a multiple of the cycles per us.
+ */
+static uint32_t cycles_per(uint32_t us, uint32_t count) {
+	const uint32_t cycles_per_us = F_CPU / 1000000UL;
+	// Scale both down first, so that us * cycles_per_us cannot overflow
+	while(us > UINT32_MAX / cycles_per_us) {
+		us    >>= 1;
+		count >>= 1;
+	}
+	return count == 0 ? 0 : us * cycles_per_us / count;
+}
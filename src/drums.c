@@ -0,0 +1,248 @@
+/************************************************************************/
+/* Includes                                                             */
+/************************************************************************/
+
+#include "drums.h"
+#include "clock.h"
+
+#include <stddef.h>
+#include <avr/pgmspace.h>
+
+/************************************************************************/
+/* Defines                                                              */
+/************************************************************************/
+
+#define SIZE(x) ((uint8_t)(sizeof(x)/sizeof(x[0])))
+
+// Tone period of a frequency, with the 2 MHz PSG clock
+#define TONE(hz) ((uint16_t)(125000UL / (hz)))
+
+/************************************************************************/
+/* Typedefs                                                             */
+/************************************************************************/
+
+typedef struct drum_step_t {
+	uint16_t tone;  /**< Tone period, 0 for no tone   */
+	uint8_t  noise; /**< Noise period, 0 for no noise */
+	uint8_t  amp;   /**< Fixed amplitude              */
+} drum_step_t;
+
+typedef struct drum_piece_t {
+	const drum_step_t * steps;
+	uint8_t             len;
+} drum_piece_t;
+
+/************************************************************************/
+/* Private function declarations                                        */
+/************************************************************************/
+
+static void borrow(void);
+static void release(void);
+static void run_step(void);
+
+/************************************************************************/
+/* Private variables                                                    */
+/************************************************************************/
+
+// A pitch drop from 150 to 50 Hz
+static const drum_step_t kick[] PROGMEM = {
+	{TONE(150), 0, 15}, {TONE(125), 0, 15}, {TONE(100), 0, 14},
+	{TONE(83),  0, 13}, {TONE(70),  0, 11}, {TONE(60),  0, 9},
+	{TONE(52),  0, 6},  {TONE(50),  0, 3},
+};
+
+// A short tone body under a longer noise tail
+static const drum_step_t snare[] PROGMEM = {
+	{TONE(250), 6, 15}, {TONE(220), 6, 14}, {0, 6, 12}, {0, 6, 10},
+	{0, 6, 8}, {0, 6, 6}, {0, 6, 4}, {0, 6, 2},
+};
+
+static const drum_step_t hat_closed[] PROGMEM = {
+	{0, 1, 12}, {0, 1, 8}, {0, 1, 4},
+};
+
+static const drum_step_t hat_open[] PROGMEM = {
+	{0, 1, 12}, {0, 1, 11}, {0, 1, 10}, {0, 1, 9}, {0, 1, 8}, {0, 1, 6},
+	{0, 1, 5},  {0, 1, 4},  {0, 1, 3},  {0, 1, 2}, {0, 1, 1},
+};
+
+static const drum_piece_t kit[DRUM_PIECES] PROGMEM = {
+	[DRUM_KICK]       = {kick,       SIZE(kick)},
+	[DRUM_SNARE]      = {snare,      SIZE(snare)},
+	[DRUM_HAT_CLOSED] = {hat_closed, SIZE(hat_closed)},
+	[DRUM_HAT_OPEN]   = {hat_open,   SIZE(hat_open)},
+};
+
+static const ay38910a_t * psg        = NULL;
+static uint8_t *          mix        = NULL;
+static sched_task_t *     drums_task = NULL;
+
+static const drum_step_t * step;
+static uint8_t             left;
+static uint8_t             chan;       // Borrowed channel index
+static bool                was_free;
+static uint16_t            saved_tone;
+static uint8_t             saved_amp;
+static bool                playing = false;
+static drums_stats_t       stats   = {0};
+
+/************************************************************************/
+/* Function implementations                                             */
+/************************************************************************/
+
+void drums_init(const ay38910a_t * ay, uint8_t * mixer, sched_task_t * task) {
+	psg        = ay;
+	mix        = mixer;
+	drums_task = task;
+	drums_task->period_ms = DRUMS_IDLE_MS;
+}
+
+void drums_hit(uint8_t piece) {
+	if(psg == NULL || piece >= DRUM_PIECES) {
+		return;
+	}
+	if(playing) {
+		stats.cuts++;
+		release();
+	}
+
+	drum_piece_t p;
+	memcpy_P(&p, &kit[piece], sizeof(p));
+	borrow();
+	step    = p.steps;
+	left    = p.len;
+	playing = true;
+	stats.hits++;
+
+	drums_task->period_ms = DRUMS_TICK_MS;
+	sched_wake(drums_task);
+}
+
+void drums_stop(void) {
+	if(playing) {
+		release();
+	}
+}
+
+uint8_t drums_piece(uint8_t note) {
+	switch(note) {
+	case 35: // Acoustic bass drum
+	case 36: // Bass drum
+		return DRUM_KICK;
+	case 37: // Side stick
+	case 38: // Acoustic snare
+	case 40: // Electric snare
+		return DRUM_SNARE;
+	case 42: // Closed hi-hat
+	case 44: // Pedal hi-hat
+		return DRUM_HAT_CLOSED;
+	case 46: // Open hi-hat
+		return DRUM_HAT_OPEN;
+	default:
+		return DRUMS_NONE;
+	}
+}
+
+bool drums_borrowed(channel_t c) {
+	return playing && ((uint8_t)c >> 1) == chan;
+}
+
+bool drums_defer(channel_t c, uint16_t tone, uint8_t amp) {
+	if(!drums_borrowed(c)) {
+		return false;
+	}
+	if(tone != 0) {
+		saved_tone = tone;
+	}
+	saved_amp = amp;
+	return true;
+}
+
+void drums_tick(void) {
+	if(!playing) {
+		return;
+	}
+
+	uint32_t start = clock_micros();
+	if(left == 0) {
+		release();
+	} else {
+		run_step();
+		step++;
+		left--;
+	}
+	uint32_t us = clock_micros() - start;
+	if(us > stats.max_us) {
+		stats.max_us = us;
+	}
+}
+
+void drums_stats(drums_stats_t * st) {
+	*st = stats;
+}
+
+/************************************************************************/
+/* Private Helpers                                                      */
+/************************************************************************/
+
+/**
+ * Picks the channel of the hit, saving the state of a busy one.
+ */
+static void borrow(void) {
+	chan     = CHANNEL_NUM - 1;
+	was_free = false;
+	for(uint8_t i = 0; i < CHANNEL_NUM; i++) {
+		if(*mix & CHAN_DISABLE(i)) {
+			chan     = i;
+			was_free = true;
+			break;
+		}
+	}
+
+	if(was_free) {
+		*mix &= CHAN_ENABLE(chan); // Busy for the keys
+	} else {
+		stats.steals++;
+		saved_tone = ay38910_read_shadow(psg, chan << 1) |
+		             ay38910_read_shadow(psg, (chan << 1) + 1) << 8;
+		saved_amp  = ay38910_read_shadow(psg, AY38910A_REG_AMP_A + chan);
+	}
+}
+
+/**
+ * Gives the channel back, with its note if it is still held.
+ */
+static void release(void) {
+	playing = false;
+	if(was_free) {
+		*mix |= CHAN_DISABLE(chan);
+		ay38910_set_amplitude(psg, chan << 1, 0);
+	} else if(*mix & CHAN_DISABLE(chan)) {
+		// Released during the hit
+		ay38910_set_amplitude(psg, chan << 1, 0);
+	} else {
+		ay38910_write_reg(psg, chan << 1, saved_tone & 0xff);
+		ay38910_write_reg(psg, (chan << 1) + 1, saved_tone >> 8);
+		ay38910_set_amplitude(psg, chan << 1, saved_amp);
+	}
+	ay38910_channel_mode(psg, *mix);
+	drums_task->period_ms = DRUMS_IDLE_MS;
+}
+
+static void run_step(void) {
+	drum_step_t s;
+	memcpy_P(&s, step, sizeof(s));
+
+	uint8_t m = *mix | CHAN_DISABLE(chan) | CHAN_DISABLE((chan + CHA_NOISE));
+	if(s.tone != 0) {
+		m &= CHAN_ENABLE(chan);
+		ay38910_write_reg(psg, chan << 1, s.tone & 0xff);
+		ay38910_write_reg(psg, (chan << 1) + 1, s.tone >> 8);
+	}
+	if(s.noise != 0) {
+		m &= CHAN_ENABLE((chan + CHA_NOISE));
+		ay38910_play_noise(psg, s.noise);
+	}
+	ay38910_channel_mode(psg, m);
+	ay38910_set_amplitude(psg, chan << 1, s.amp);
+}
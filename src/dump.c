@@ -0,0 +1,200 @@
+/************************************************************************/
+/* Includes                                                             */
+/************************************************************************/
+
+#include "dump.h"
+#include "clock.h"
+
+#include <stddef.h>
+#include <avr/pgmspace.h>
+
+/************************************************************************/
+/* Defines                                                              */
+/************************************************************************/
+
+#define WINDOW_MASK   (DUMP_WINDOW - 1)
+#define IS_MATCH(tok) ((tok) & 0x80)
+
+#if DUMP_WINDOW & WINDOW_MASK
+#error "DUMP_WINDOW must be a power of 2"
+#endif
+
+/************************************************************************/
+/* Typedefs                                                             */
+/************************************************************************/
+
+typedef struct decoder_t {
+	const uint8_t * src;   /**< Next stream byte, in flash         */
+	uint16_t        head;  /**< Next window byte to write          */
+	uint16_t        dist;  /**< Distance of the current match      */
+	uint8_t         left;  /**< Bytes left in the current token    */
+	bool            match; /**< The current token is a match       */
+} decoder_t;
+
+/************************************************************************/
+/* Private function declarations                                        */
+/************************************************************************/
+
+static void decode_frame(uint8_t * frame);
+static uint8_t write_frame(const uint8_t * frame);
+static void rewind_to(uint16_t frame, uint16_t offset);
+
+/************************************************************************/
+/* Private variables                                                    */
+/************************************************************************/
+
+static const ay38910a_t * psg       = NULL;
+static uint8_t *          mix       = NULL;
+static sched_task_t *     dump_task = NULL;
+
+static dump_t       dump;  // SRAM copy of the descriptor only
+static decoder_t    dec;
+static uint16_t     frame_idx;
+static uint8_t      window[DUMP_WINDOW];
+static uint8_t      last[AY38910A_REGS];
+static bool         fresh   = false; // Write every register of the frame
+static bool         playing = false;
+static dump_stats_t stats   = {0};
+
+/************************************************************************/
+/* Function implementations                                             */
+/************************************************************************/
+
+void dump_init(const ay38910a_t * ay, uint8_t * mixer, sched_task_t * task) {
+	psg       = ay;
+	mix       = mixer;
+	dump_task = task;
+	dump_task->period_ms = DUMP_IDLE_MS;
+}
+
+bool dump_play(const dump_t * d) {
+	dump_stop();
+	memcpy_P(&dump, d, sizeof(dump));
+	if(dump.window > DUMP_WINDOW || dump.frames == 0) {
+		return false;
+	}
+
+	rewind_to(0, 0);
+	fresh   = true;
+	playing = true;
+
+	dump_task->period_ms = dump.frame_ms;
+	sched_wake(dump_task);
+	return true;
+}
+
+void dump_stop(void) {
+	if(!playing) {
+		return;
+	}
+	playing = false;
+	for(uint8_t ch = 0; ch < CHANNEL_NUM; ch++) {
+		ay38910_set_amplitude(psg, (channel_t)(ch << 1), 0);
+	}
+	ay38910_channel_mode(psg, *mix);
+	dump_task->period_ms = DUMP_IDLE_MS;
+}
+
+bool dump_playing(void) {
+	return playing;
+}
+
+void dump_frame(void) {
+	if(!playing) {
+		return;
+	}
+
+	uint8_t  frame[AY38910A_REGS];
+	uint32_t start = clock_micros();
+	decode_frame(frame);
+	uint32_t decoded = clock_micros();
+	stats.writes += write_frame(frame);
+	uint32_t end = clock_micros();
+
+	uint16_t decode_us = decoded - start;
+	uint16_t frame_us  = end - start;
+	stats.frames++;
+	stats.decode_us = decode_us;
+	if(decode_us > stats.max_decode_us) {
+		stats.max_decode_us = decode_us;
+	}
+	if(frame_us > stats.max_frame_us) {
+		stats.max_frame_us = frame_us;
+	}
+
+	if(++frame_idx < dump.frames) {
+		return;
+	}
+	if(dump.loop < dump.frames) {
+		rewind_to(dump.loop, dump.loop_at);
+	} else {
+		dump_stop();
+	}
+}
+
+void dump_stats(dump_stats_t * st) {
+	*st = stats;
+}
+
+/************************************************************************/
+/* Private Helpers                                                      */
+/************************************************************************/
+
+/**
+ * Decodes the next AY38910A_REGS bytes of the stream, going through the
+ * window. Tokens that do not end with the frame are resumed at the next.
+ */
+static void decode_frame(uint8_t * frame) {
+	for(uint8_t i = 0; i < AY38910A_REGS; i++) {
+		if(dec.left == 0) {
+			uint8_t tok = pgm_read_byte(dec.src++);
+			dec.match = IS_MATCH(tok);
+			if(dec.match) {
+				dec.left = (tok & 0x7f) + DUMP_MIN_MATCH;
+				dec.dist = pgm_read_word(dec.src);
+				dec.src += 2;
+			} else {
+				dec.left = tok + 1;
+			}
+		}
+
+		uint8_t b;
+		if(dec.match) {
+			b = window[(dec.head - dec.dist) & WINDOW_MASK];
+		} else {
+			b = pgm_read_byte(dec.src++);
+		}
+		window[dec.head++ & WINDOW_MASK] = b;
+		frame[i] = b;
+		dec.left--;
+	}
+}
+
+/**
+ * Writes the registers that changed since the previous frame.
+ * @return the number of registers written
+ */
+static uint8_t write_frame(const uint8_t * frame) {
+	uint8_t n = 0;
+	for(uint8_t reg = 0; reg < AY38910A_REG_ENV_SHP; reg++) {
+		if(fresh || frame[reg] != last[reg]) {
+			ay38910_write_reg(psg, reg, frame[reg]);
+			last[reg] = frame[reg];
+			n++;
+		}
+	}
+	// Any write restarts the envelope, the dump tells when to do it
+	if(frame[AY38910A_REG_ENV_SHP] != DUMP_NO_WRITE) {
+		ay38910_write_reg(psg, AY38910A_REG_ENV_SHP,
+		                  frame[AY38910A_REG_ENV_SHP]);
+		n++;
+	}
+	fresh = false;
+	return n;
+}
+
+static void rewind_to(uint16_t frame, uint16_t offset) {
+	frame_idx = frame;
+	dec.src   = dump.data + offset;
+	dec.left  = 0;
+}
@@ -0,0 +1,194 @@
+#include "dump.h"
+
+#include <avr/pgmspace.h>
+
+/**
+ * Generated by scripts/ym2dump.py from demo.bin,
+ * 400 frames of 20 ms, 2084 bytes.
+ */
+
+static const uint8_t demo_data[] PROGMEM = {
+	0x0d, 0x1c, 0x01, 0x70, 0x04, 0x00, 0x00, 0x06, 0x1c, 0x0d, 0x10, 0x0c,
+	0x00, 0x08, 0x08, 0x87, 0x0e, 0x00, 0x05, 0x0b, 0x00, 0x08, 0xff, 0xef,
+	0x00, 0x85, 0x0e, 0x00, 0x00, 0x0a, 0x8a, 0x0e, 0x00, 0x00, 0x09, 0x80,
+	0x0e, 0x00, 0x00, 0xbe, 0x86, 0x0e, 0x00, 0x00, 0x08, 0x8a, 0x0e, 0x00,
+	0x00, 0x07, 0x80, 0x0e, 0x00, 0x00, 0x8e, 0x86, 0x0e, 0x00, 0x00, 0x06,
+	0x8a, 0x0e, 0x00, 0x00, 0x05, 0x80, 0x0e, 0x00, 0x00, 0x77, 0x86, 0x0e,
+	0x00, 0x00, 0x04, 0x8a, 0x0e, 0x00, 0x00, 0x03, 0x80, 0x0e, 0x00, 0x00,
+	0x5f, 0x84, 0x0e, 0x00, 0x02, 0x0c, 0x10, 0x02, 0x8a, 0x0e, 0x00, 0x00,
+	0x01, 0x80, 0x0e, 0x00, 0x85, 0x9a, 0x00, 0x02, 0x0c, 0x10, 0x00, 0x8e,
+	0x0e, 0x00, 0x85, 0x9a, 0x00, 0x91, 0x0e, 0x00, 0x85, 0x9a, 0x00, 0x91,
+	0x0e, 0x00, 0x85, 0x9a, 0x00, 0x91, 0x0e, 0x00, 0x85, 0x9a, 0x00, 0x00,
+	0x0b, 0x90, 0x0e, 0x00, 0x85, 0x9a, 0x00, 0x91, 0x0e, 0x00, 0x85, 0x9a,
+	0x00, 0x89, 0x0e, 0x00, 0x00, 0x01, 0x80, 0x0e, 0x00, 0x00, 0x0c, 0x86,
+	0x9a, 0x00, 0x81, 0x0e, 0x00, 0x00, 0x0b, 0x8a, 0x0e, 0x00, 0x00, 0x0a,
+	0x86, 0x9a, 0x00, 0x81, 0x0e, 0x00, 0x00, 0x09, 0x8a, 0x0e, 0x00, 0x00,
+	0x08, 0x86, 0x9a, 0x00, 0x04, 0x01, 0x1c, 0x0a, 0x10, 0x07, 0x8a, 0x0e,
+	0x00, 0x00, 0x06, 0x86, 0x9a, 0x00, 0x81, 0x0e, 0x00, 0x00, 0x05, 0x8a,
+	0x0e, 0x00, 0x00, 0x04, 0x86, 0x9a, 0x00, 0x81, 0x0e, 0x00, 0x00, 0x03,
+	0x8a, 0x0e, 0x00, 0x00, 0x02, 0x88, 0x9a, 0x00, 0x02, 0x0a, 0x10, 0x01,
+	0x8a, 0x0e, 0x00, 0x81, 0xb6, 0x00, 0x85, 0x9a, 0x00, 0x91, 0x0e, 0x00,
+	0x85, 0x9a, 0x00, 0x00, 0x09, 0x90, 0x0e, 0x00, 0x85, 0x9a, 0x00, 0x91,
+	0x0e, 0x00, 0x85, 0x9a, 0x00, 0x91, 0x0e, 0x00, 0x85, 0x9a, 0x00, 0x91,
+	0x0e, 0x00, 0x85, 0x9a, 0x00, 0x91, 0x0e, 0x00, 0x83, 0x9a, 0x00, 0x04,
+	0x06, 0x1c, 0x0d, 0x10, 0x0c, 0x8a, 0x0e, 0x00, 0x00, 0x0b, 0x86, 0x9a,
+	0x00, 0x81, 0x0e, 0x00, 0x00, 0x0a, 0x8a, 0x0e, 0x00, 0x00, 0x09, 0x86,
+	0x9a, 0x00, 0x81, 0x0e, 0x00, 0x00, 0x08, 0x8a, 0x0e, 0x00, 0x00, 0x07,
+	0x86, 0x9a, 0x00, 0x81, 0x0e, 0x00, 0x00, 0x06, 0x8a, 0x0e, 0x00, 0x00,
+	0x05, 0x86, 0x9a, 0x00, 0x81, 0x0e, 0x00, 0x00, 0x04, 0x8a, 0x0e, 0x00,
+	0x00, 0x03, 0x86, 0x9a, 0x00, 0x04, 0x06, 0x1c, 0x0c, 0x10, 0x02, 0x8a,
+	0x0e, 0x00, 0x00, 0x01, 0x88, 0x9a, 0x00, 0x00, 0x0c, 0x8a, 0xb6, 0x00,
+	0x83, 0x0e, 0x00, 0x85, 0x9a, 0x00, 0x91, 0x0e, 0x00, 0x85, 0x9a, 0x00,
+	0x91, 0x0e, 0x00, 0x85, 0x9a, 0x00, 0x91, 0x0e, 0x00, 0x85, 0x9a, 0x00,
+	0x00, 0x0b, 0x90, 0x0e, 0x00, 0x85, 0x9a, 0x00, 0x91, 0x0e, 0x00, 0x85,
+	0x9a, 0x00, 0x89, 0x0e, 0x00, 0x00, 0x01, 0x80, 0x0e, 0x00, 0x00, 0x0c,
+	0x86, 0x9a, 0x00, 0x81, 0x0e, 0x00, 0x00, 0x0b, 0x8a, 0x0e, 0x00, 0x00,
+	0x0a, 0x86, 0x9a, 0x00, 0x81, 0x0e, 0x00, 0x00, 0x09, 0x8a, 0x0e, 0x00,
+	0x00, 0x08, 0x86, 0x9a, 0x00, 0x04, 0x01, 0x1c, 0x0a, 0x10, 0x07, 0x8a,
+	0x0e, 0x00, 0x00, 0x06, 0x86, 0x9a, 0x00, 0x81, 0x0e, 0x00, 0x00, 0x05,
+	0x8a, 0x0e, 0x00, 0x00, 0x04, 0x86, 0x9a, 0x00, 0x81, 0x0e, 0x00, 0x00,
+	0x03, 0x8a, 0x0e, 0x00, 0x00, 0x02, 0x88, 0x9a, 0x00, 0x02, 0x0a, 0x10,
+	0x01, 0x8a, 0x0e, 0x00, 0x81, 0xb6, 0x00, 0x85, 0x9a, 0x00, 0x91, 0x0e,
+	0x00, 0x85, 0x9a, 0x00, 0x00, 0x09, 0x90, 0x0e, 0x00, 0x85, 0x9a, 0x00,
+	0x91, 0x0e, 0x00, 0x85, 0x9a, 0x00, 0x91, 0x0e, 0x00, 0x85, 0x9a, 0x00,
+	0x91, 0x0e, 0x00, 0x85, 0x9a, 0x00, 0x93, 0x0e, 0x00, 0x0b, 0x98, 0x05,
+	0x00, 0x00, 0x06, 0x1c, 0x0d, 0x10, 0x0c, 0x00, 0x08, 0x08, 0x87, 0x0e,
+	0x00, 0x00, 0x0b, 0x80, 0x1c, 0x00, 0x00, 0xb3, 0x86, 0x0e, 0x00, 0x00,
+	0x0a, 0x8a, 0x0e, 0x00, 0x00, 0x09, 0x82, 0xb6, 0x00, 0x85, 0x0e, 0x00,
+	0x00, 0x08, 0x8a, 0x0e, 0x00, 0x00, 0x07, 0x82, 0xb6, 0x00, 0x85, 0x0e,
+	0x00, 0x00, 0x06, 0x8a, 0x0e, 0x00, 0x00, 0x05, 0x80, 0x0e, 0x00, 0x01,
+	0x66, 0x01, 0x85, 0x0e, 0x00, 0x00, 0x04, 0x8a, 0x0e, 0x00, 0x00, 0x03,
+	0x82, 0xb6, 0x00, 0x83, 0x0e, 0x00, 0x02, 0x0c, 0x10, 0x02, 0x8a, 0x0e,
+	0x00, 0x00, 0x01, 0x88, 0xa8, 0x00, 0x00, 0x0c, 0x8a, 0xb6, 0x00, 0x83,
+	0x0e, 0x00, 0x85, 0x9a, 0x00, 0x91, 0x0e, 0x00, 0x85, 0x9a, 0x00, 0x91,
+	0x0e, 0x00, 0x85, 0x9a, 0x00, 0x91, 0x0e, 0x00, 0x85, 0x9a, 0x00, 0x00,
+	0x0b, 0x90, 0x0e, 0x00, 0x85, 0x9a, 0x00, 0x91, 0x0e, 0x00, 0x85, 0x9a,
+	0x00, 0x89, 0x0e, 0x00, 0x00, 0x01, 0x80, 0x0e, 0x00, 0x00, 0x0c, 0x86,
+	0x9a, 0x00, 0x81, 0x0e, 0x00, 0x00, 0x0b, 0x8a, 0x0e, 0x00, 0x00, 0x0a,
+	0x86, 0x9a, 0x00, 0x81, 0x0e, 0x00, 0x00, 0x09, 0x8a, 0x0e, 0x00, 0x00,
+	0x08, 0x86, 0x9a, 0x00, 0x04, 0x01, 0x1c, 0x0a, 0x10, 0x07, 0x8a, 0x0e,
+	0x00, 0x00, 0x06, 0x86, 0x9a, 0x00, 0x81, 0x0e, 0x00, 0x00, 0x05, 0x8a,
+	0x0e, 0x00, 0x00, 0x04, 0x86, 0x9a, 0x00, 0x81, 0x0e, 0x00, 0x00, 0x03,
+	0x8a, 0x0e, 0x00, 0x00, 0x02, 0x88, 0x9a, 0x00, 0x02, 0x0a, 0x10, 0x01,
+	0x8a, 0x0e, 0x00, 0x81, 0xb6, 0x00, 0x85, 0x9a, 0x00, 0x91, 0x0e, 0x00,
+	0x85, 0x9a, 0x00, 0x00, 0x09, 0x90, 0x0e, 0x00, 0x85, 0x9a, 0x00, 0x91,
+	0x0e, 0x00, 0x85, 0x9a, 0x00, 0x91, 0x0e, 0x00, 0x85, 0x9a, 0x00, 0x91,
+	0x0e, 0x00, 0x85, 0x9a, 0x00, 0x91, 0x0e, 0x00, 0x83, 0x9a, 0x00, 0x04,
+	0x06, 0x1c, 0x0d, 0x10, 0x0c, 0x8a, 0x0e, 0x00, 0x00, 0x0b, 0x86, 0x9a,
+	0x00, 0x81, 0x0e, 0x00, 0x00, 0x0a, 0x8a, 0x0e, 0x00, 0x00, 0x09, 0x86,
+	0x9a, 0x00, 0x81, 0x0e, 0x00, 0x00, 0x08, 0x8a, 0x0e, 0x00, 0x00, 0x07,
+	0x86, 0x9a, 0x00, 0x81, 0x0e, 0x00, 0x00, 0x06, 0x8a, 0x0e, 0x00, 0x00,
+	0x05, 0x86, 0x9a, 0x00, 0x81, 0x0e, 0x00, 0x00, 0x04, 0x8a, 0x0e, 0x00,
+	0x00, 0x03, 0x86, 0x9a, 0x00, 0x04, 0x06, 0x1c, 0x0c, 0x10, 0x02, 0x8a,
+	0x0e, 0x00, 0x00, 0x01, 0x88, 0x9a, 0x00, 0x00, 0x0c, 0x8a, 0xb6, 0x00,
+	0x83, 0x0e, 0x00, 0x85, 0x9a, 0x00, 0x91, 0x0e, 0x00, 0x85, 0x9a, 0x00,
+	0x91, 0x0e, 0x00, 0x85, 0x9a, 0x00, 0x91, 0x0e, 0x00, 0x85, 0x9a, 0x00,
+	0x00, 0x0b, 0x90, 0x0e, 0x00, 0x85, 0x9a, 0x00, 0x91, 0x0e, 0x00, 0x85,
+	0x9a, 0x00, 0x89, 0x0e, 0x00, 0x00, 0x01, 0x80, 0x0e, 0x00, 0x00, 0x0c,
+	0x86, 0x9a, 0x00, 0x81, 0x0e, 0x00, 0x00, 0x0b, 0x8a, 0x0e, 0x00, 0x00,
+	0x0a, 0x86, 0x9a, 0x00, 0x81, 0x0e, 0x00, 0x00, 0x09, 0x8a, 0x0e, 0x00,
+	0x00, 0x08, 0x86, 0x9a, 0x00, 0x04, 0x01, 0x1c, 0x0a, 0x10, 0x07, 0x8a,
+	0x0e, 0x00, 0x00, 0x06, 0x86, 0x9a, 0x00, 0x81, 0x0e, 0x00, 0x00, 0x05,
+	0x8a, 0x0e, 0x00, 0x00, 0x04, 0x86, 0x9a, 0x00, 0x81, 0x0e, 0x00, 0x00,
+	0x03, 0x8a, 0x0e, 0x00, 0x00, 0x02, 0x88, 0x9a, 0x00, 0x02, 0x0a, 0x10,
+	0x01, 0x8a, 0x0e, 0x00, 0x81, 0xb6, 0x00, 0x85, 0x9a, 0x00, 0x91, 0x0e,
+	0x00, 0x85, 0x9a, 0x00, 0x00, 0x09, 0x90, 0x0e, 0x00, 0x85, 0x9a, 0x00,
+	0x91, 0x0e, 0x00, 0x85, 0x9a, 0x00, 0x91, 0x0e, 0x00, 0x85, 0x9a, 0x00,
+	0x91, 0x0e, 0x00, 0x85, 0x9a, 0x00, 0x91, 0x0e, 0x00, 0x0d, 0x5f, 0x00,
+	0xbc, 0x03, 0x00, 0x00, 0x06, 0x1c, 0x0d, 0x10, 0x0c, 0x00, 0x08, 0x08,
+	0x87, 0x0e, 0x00, 0x00, 0x0b, 0x80, 0x1c, 0x00, 0x00, 0x50, 0x86, 0x0e,
+	0x00, 0x00, 0x0a, 0x8a, 0x0e, 0x00, 0x00, 0x09, 0x82, 0x62, 0x00, 0x85,
+	0x0e, 0x00, 0x00, 0x08, 0x8a, 0x0e, 0x00, 0x00, 0x07, 0x80, 0x0e, 0x00,
+	0x00, 0xbe, 0x86, 0x0e, 0x00, 0x00, 0x06, 0x8a, 0x0e, 0x00, 0x00, 0x05,
+	0x80, 0x0e, 0x00, 0x00, 0x9f, 0x86, 0x0e, 0x00, 0x00, 0x04, 0x8a, 0x0e,
+	0x00, 0x00, 0x03, 0x80, 0x0e, 0x00, 0x00, 0x77, 0x84, 0x0e, 0x00, 0x02,
+	0x0c, 0x10, 0x02, 0x8a, 0x0e, 0x00, 0x00, 0x01, 0x88, 0xa8, 0x00, 0x00,
+	0x0c, 0x8a, 0xb6, 0x00, 0x83, 0x0e, 0x00, 0x85, 0x9a, 0x00, 0x91, 0x0e,
+	0x00, 0x85, 0x9a, 0x00, 0x91, 0x0e, 0x00, 0x85, 0x9a, 0x00, 0x91, 0x0e,
+	0x00, 0x85, 0x9a, 0x00, 0x00, 0x0b, 0x90, 0x0e, 0x00, 0x85, 0x9a, 0x00,
+	0x91, 0x0e, 0x00, 0x85, 0x9a, 0x00, 0x89, 0x0e, 0x00, 0x00, 0x01, 0x80,
+	0x0e, 0x00, 0x00, 0x0c, 0x86, 0x9a, 0x00, 0x81, 0x0e, 0x00, 0x00, 0x0b,
+	0x8a, 0x0e, 0x00, 0x00, 0x0a, 0x86, 0x9a, 0x00, 0x81, 0x0e, 0x00, 0x00,
+	0x09, 0x8a, 0x0e, 0x00, 0x00, 0x08, 0x86, 0x9a, 0x00, 0x04, 0x01, 0x1c,
+	0x0a, 0x10, 0x07, 0x8a, 0x0e, 0x00, 0x00, 0x06, 0x86, 0x9a, 0x00, 0x81,
+	0x0e, 0x00, 0x00, 0x05, 0x8a, 0x0e, 0x00, 0x00, 0x04, 0x86, 0x9a, 0x00,
+	0x81, 0x0e, 0x00, 0x00, 0x03, 0x8a, 0x0e, 0x00, 0x00, 0x02, 0x88, 0x9a,
+	0x00, 0x02, 0x0a, 0x10, 0x01, 0x8a, 0x0e, 0x00, 0x81, 0xb6, 0x00, 0x85,
+	0x9a, 0x00, 0x91, 0x0e, 0x00, 0x85, 0x9a, 0x00, 0x00, 0x09, 0x90, 0x0e,
+	0x00, 0x85, 0x9a, 0x00, 0x91, 0x0e, 0x00, 0x85, 0x9a, 0x00, 0x91, 0x0e,
+	0x00, 0x85, 0x9a, 0x00, 0x91, 0x0e, 0x00, 0x85, 0x9a, 0x00, 0x91, 0x0e,
+	0x00, 0x83, 0x9a, 0x00, 0x04, 0x06, 0x1c, 0x0d, 0x10, 0x0c, 0x8a, 0x0e,
+	0x00, 0x00, 0x0b, 0x86, 0x9a, 0x00, 0x81, 0x0e, 0x00, 0x00, 0x0a, 0x8a,
+	0x0e, 0x00, 0x00, 0x09, 0x86, 0x9a, 0x00, 0x81, 0x0e, 0x00, 0x00, 0x08,
+	0x8a, 0x0e, 0x00, 0x00, 0x07, 0x86, 0x9a, 0x00, 0x81, 0x0e, 0x00, 0x00,
+	0x06, 0x8a, 0x0e, 0x00, 0x00, 0x05, 0x86, 0x9a, 0x00, 0x81, 0x0e, 0x00,
+	0x00, 0x04, 0x8a, 0x0e, 0x00, 0x00, 0x03, 0x86, 0x9a, 0x00, 0x04, 0x06,
+	0x1c, 0x0c, 0x10, 0x02, 0x8a, 0x0e, 0x00, 0x00, 0x01, 0x88, 0x9a, 0x00,
+	0x00, 0x0c, 0x8a, 0xb6, 0x00, 0x83, 0x0e, 0x00, 0x85, 0x9a, 0x00, 0x91,
+	0x0e, 0x00, 0x85, 0x9a, 0x00, 0x91, 0x0e, 0x00, 0x85, 0x9a, 0x00, 0x91,
+	0x0e, 0x00, 0x85, 0x9a, 0x00, 0x00, 0x0b, 0x90, 0x0e, 0x00, 0x85, 0x9a,
+	0x00, 0x91, 0x0e, 0x00, 0x85, 0x9a, 0x00, 0x89, 0x0e, 0x00, 0x00, 0x01,
+	0x80, 0x0e, 0x00, 0x00, 0x0c, 0x86, 0x9a, 0x00, 0x81, 0x0e, 0x00, 0x00,
+	0x0b, 0x8a, 0x0e, 0x00, 0x00, 0x0a, 0x86, 0x9a, 0x00, 0x81, 0x0e, 0x00,
+	0x00, 0x09, 0x8a, 0x0e, 0x00, 0x00, 0x08, 0x86, 0x9a, 0x00, 0x04, 0x01,
+	0x1c, 0x0a, 0x10, 0x07, 0x8a, 0x0e, 0x00, 0x00, 0x06, 0x86, 0x9a, 0x00,
+	0x81, 0x0e, 0x00, 0x00, 0x05, 0x8a, 0x0e, 0x00, 0x00, 0x04, 0x86, 0x9a,
+	0x00, 0x81, 0x0e, 0x00, 0x00, 0x03, 0x8a, 0x0e, 0x00, 0x00, 0x02, 0x88,
+	0x9a, 0x00, 0x02, 0x0a, 0x10, 0x01, 0x8a, 0x0e, 0x00, 0x81, 0xb6, 0x00,
+	0x85, 0x9a, 0x00, 0x91, 0x0e, 0x00, 0x85, 0x9a, 0x00, 0x00, 0x09, 0x90,
+	0x0e, 0x00, 0x85, 0x9a, 0x00, 0x91, 0x0e, 0x00, 0x85, 0x9a, 0x00, 0x91,
+	0x0e, 0x00, 0x85, 0x9a, 0x00, 0x91, 0x0e, 0x00, 0x85, 0x9a, 0x00, 0x91,
+	0x0e, 0x00, 0x0d, 0x3f, 0x01, 0xfc, 0x04, 0x00, 0x00, 0x06, 0x1c, 0x0d,
+	0x10, 0x0c, 0x00, 0x08, 0x08, 0x87, 0x0e, 0x00, 0x00, 0x0b, 0x80, 0x1c,
+	0x00, 0x01, 0xfd, 0x00, 0x85, 0x0e, 0x00, 0x00, 0x0a, 0x8a, 0x0e, 0x00,
+	0x00, 0x09, 0x80, 0x0e, 0x00, 0x00, 0xd5, 0x86, 0x0e, 0x00, 0x00, 0x08,
+	0x8a, 0x0e, 0x00, 0x00, 0x07, 0x82, 0xb6, 0x00, 0x85, 0x0e, 0x00, 0x00,
+	0x06, 0x8a, 0x0e, 0x00, 0x00, 0x05, 0x80, 0x0e, 0x00, 0x00, 0x7f, 0x86,
+	0x0e, 0x00, 0x00, 0x04, 0x8a, 0x0e, 0x00, 0x00, 0x03, 0x80, 0x0e, 0x00,
+	0x00, 0x6a, 0x84, 0x0e, 0x00, 0x02, 0x0c, 0x10, 0x02, 0x8a, 0x0e, 0x00,
+	0x00, 0x01, 0x88, 0xa8, 0x00, 0x00, 0x0c, 0x8a, 0xb6, 0x00, 0x83, 0x0e,
+	0x00, 0x85, 0x9a, 0x00, 0x91, 0x0e, 0x00, 0x85, 0x9a, 0x00, 0x91, 0x0e,
+	0x00, 0x85, 0x9a, 0x00, 0x91, 0x0e, 0x00, 0x85, 0x9a, 0x00, 0x00, 0x0b,
+	0x90, 0x0e, 0x00, 0x85, 0x9a, 0x00, 0x91, 0x0e, 0x00, 0x85, 0x9a, 0x00,
+	0x89, 0x0e, 0x00, 0x00, 0x01, 0x80, 0x0e, 0x00, 0x00, 0x0c, 0x86, 0x9a,
+	0x00, 0x81, 0x0e, 0x00, 0x00, 0x0b, 0x8a, 0x0e, 0x00, 0x00, 0x0a, 0x86,
+	0x9a, 0x00, 0x81, 0x0e, 0x00, 0x00, 0x09, 0x8a, 0x0e, 0x00, 0x00, 0x08,
+	0x86, 0x9a, 0x00, 0x04, 0x01, 0x1c, 0x0a, 0x10, 0x07, 0x8a, 0x0e, 0x00,
+	0x00, 0x06, 0x86, 0x9a, 0x00, 0x81, 0x0e, 0x00, 0x00, 0x05, 0x8a, 0x0e,
+	0x00, 0x00, 0x04, 0x86, 0x9a, 0x00, 0x81, 0x0e, 0x00, 0x00, 0x03, 0x8a,
+	0x0e, 0x00, 0x00, 0x02, 0x88, 0x9a, 0x00, 0x02, 0x0a, 0x10, 0x01, 0x8a,
+	0x0e, 0x00, 0x81, 0xb6, 0x00, 0x85, 0x9a, 0x00, 0x91, 0x0e, 0x00, 0x85,
+	0x9a, 0x00, 0x00, 0x09, 0x90, 0x0e, 0x00, 0x85, 0x9a, 0x00, 0x91, 0x0e,
+	0x00, 0x85, 0x9a, 0x00, 0x91, 0x0e, 0x00, 0x85, 0x9a, 0x00, 0x91, 0x0e,
+	0x00, 0x85, 0x9a, 0x00, 0x91, 0x0e, 0x00, 0x83, 0x9a, 0x00, 0x04, 0x06,
+	0x1c, 0x0d, 0x10, 0x0c, 0x8a, 0x0e, 0x00, 0x00, 0x0b, 0x86, 0x9a, 0x00,
+	0x81, 0x0e, 0x00, 0x00, 0x0a, 0x8a, 0x0e, 0x00, 0x00, 0x09, 0x86, 0x9a,
+	0x00, 0x81, 0x0e, 0x00, 0x00, 0x08, 0x8a, 0x0e, 0x00, 0x00, 0x07, 0x86,
+	0x9a, 0x00, 0x81, 0x0e, 0x00, 0x00, 0x06, 0x8a, 0x0e, 0x00, 0x00, 0x05,
+	0x86, 0x9a, 0x00, 0x81, 0x0e, 0x00, 0x00, 0x04, 0x8a, 0x0e, 0x00, 0x00,
+	0x03, 0x86, 0x9a, 0x00, 0x04, 0x06, 0x1c, 0x0c, 0x10, 0x02, 0x8a, 0x0e,
+	0x00, 0x00, 0x01, 0x88, 0x9a, 0x00, 0x00, 0x0c, 0x8a, 0xb6, 0x00, 0x83,
+	0x0e, 0x00, 0x85, 0x9a, 0x00, 0x91, 0x0e, 0x00, 0x85, 0x9a, 0x00, 0x91,
+	0x0e, 0x00, 0x85, 0x9a, 0x00, 0x91, 0x0e, 0x00, 0x85, 0x9a, 0x00, 0x00,
+	0x0b, 0x90, 0x0e, 0x00, 0x85, 0x9a, 0x00, 0x91, 0x0e, 0x00, 0x85, 0x9a,
+	0x00, 0x89, 0x0e, 0x00, 0x00, 0x01, 0x80, 0x0e, 0x00, 0x00, 0x0c, 0x86,
+	0x9a, 0x00, 0x81, 0x0e, 0x00, 0x00, 0x0b, 0x8a, 0x0e, 0x00, 0x00, 0x0a,
+	0x86, 0x9a, 0x00, 0x81, 0x0e, 0x00, 0x00, 0x09, 0x8a, 0x0e, 0x00, 0x00,
+	0x08, 0x86, 0x9a, 0x00, 0x04, 0x01, 0x1c, 0x0a, 0x10, 0x07, 0x8a, 0x0e,
+	0x00, 0x00, 0x06, 0x86, 0x9a, 0x00, 0x81, 0x0e, 0x00, 0x00, 0x05, 0x8a,
+	0x0e, 0x00, 0x00, 0x04, 0x86, 0x9a, 0x00, 0x81, 0x0e, 0x00, 0x00, 0x03,
+	0x8a, 0x0e, 0x00, 0x00, 0x02, 0x88, 0x9a, 0x00, 0x02, 0x0a, 0x10, 0x01,
+	0x8a, 0x0e, 0x00, 0x81, 0xb6, 0x00, 0x85, 0x9a, 0x00, 0x91, 0x0e, 0x00,
+	0x85, 0x9a, 0x00, 0x00, 0x09, 0x90, 0x0e, 0x00, 0x85, 0x9a, 0x00, 0x91,
+	0x0e, 0x00, 0x85, 0x9a, 0x00, 0x91, 0x0e, 0x00, 0x85, 0x9a, 0x00, 0x91,
+	0x0e, 0x00, 0x85, 0x9a, 0x00, 0x91, 0x0e, 0x00,
+};
+
+const dump_t dump_demo PROGMEM = {
+	.frame_ms = 20,
+	.window   = 256,
+	.frames   = 400,
+	.loop     = 0,
+	.loop_at  = 0,
+	.data     = demo_data,
+};
@@ -0,0 +1,119 @@
+/************************************************************************/
+/* Includes                                                             */
+/************************************************************************/
+
+#include "fmt.h"
+
+#include <stdbool.h>
+#include <avr/pgmspace.h>
+
+/************************************************************************/
+/* Defines                                                              */
+/************************************************************************/
+
+#define MAX_DEC_DIGITS   (5)
+#define MAX_DEC32_DIGITS (10)
+
+/************************************************************************/
+/* Private variables                                                    */
+/************************************************************************/
+
+static const uint16_t pow10[MAX_DEC_DIGITS - 1] PROGMEM = {10000, 1000, 100, 10};
+
+static const uint32_t pow10_32[MAX_DEC32_DIGITS - 1] PROGMEM = {
+	1000000000UL, 100000000UL, 10000000UL, 1000000UL, 100000UL,
+	10000UL, 1000UL, 100UL, 10UL
+};
+
+static const char hex_digits[] PROGMEM = "0123456789abcdef";
+
+/************************************************************************/
+/* Function implementations                                             */
+/************************************************************************/
+
+char * fmt_udec(char * dst, uint16_t v, uint8_t width, char pad) {
+	char    digits[MAX_DEC_DIGITS];
+	uint8_t len = 0;
+
+	for(uint8_t i = 0; i < MAX_DEC_DIGITS - 1; i++) {
+		char     d = '0';
+		uint16_t p = pgm_read_word(&pow10[i]);
+		while(v >= p) {
+			v -= p;
+			d++;
+		}
+		if(len != 0 || d != '0') {
+			digits[len++] = d;
+		}
+	}
+	digits[len++] = (char)('0' + v);
+
+	while(width > len) {
+		*dst++ = pad;
+		width--;
+	}
+	for(uint8_t i = 0; i < len; i++) {
+		*dst++ = digits[i];
+	}
+	*dst = '\0';
+	return dst;
+}
+
+char * fmt_udec32(char * dst, uint32_t v) {
+	bool leading = true;
+	for(uint8_t i = 0; i < MAX_DEC32_DIGITS - 1; i++) {
+		char     d = '0';
+		uint32_t p = pgm_read_dword(&pow10_32[i]);
+		while(v >= p) {
+			v -= p;
+			d++;
+		}
+		if(!leading || d != '0') {
+			*dst++ = d;
+			leading = false;
+		}
+	}
+	*dst++ = (char)('0' + v);
+	*dst = '\0';
+	return dst;
+}
+
+char * fmt_hex(char * dst, uint16_t v, uint8_t digits) {
+	if(digits > 4) {
+		digits = 4;
+	}
+	for(int8_t shift = (digits - 1) * 4; shift >= 0; shift -= 4) {
+		*dst++ = pgm_read_byte(&hex_digits[(v >> shift) & 0x0f]);
+	}
+	*dst = '\0';
+	return dst;
+}
+
+char * fmt_str(char * dst, const char * src, uint8_t width) {
+	while(*src) {
+		*dst++ = *src++;
+		if(width != 0) {
+			width--;
+		}
+	}
+	while(width-- > 0) {
+		*dst++ = ' ';
+	}
+	*dst = '\0';
+	return dst;
+}
+
+char * fmt_str_P(char * dst, const char * src, uint8_t width) {
+	char c;
+	while((c = pgm_read_byte(src++)) != '\0') {
+		*dst++ = c;
+		if(width != 0) {
+			width--;
+		}
+	}
+	while(width-- > 0) {
+		*dst++ = ' ';
+	}
+	*dst = '\0';
+	return dst;
+}
@@ -0,0 +1,358 @@
+/************************************************************************/
+/* Includes                                                             */
+/************************************************************************/
+
+#include "input.h"
+#include "adc.h"
+#include "clock.h"
+#include "settings.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <util/atomic.h>
+
+/************************************************************************/
+/* Defines                                                              */
+/************************************************************************/
+
+#define EV_SIZE  4
+#define EV_PORT  0x00
+#define EV_BYTE  0x20
+#define EV_NOP   0x7f
+#define EV_ADC   0x80
+
+#define HEADER_FIXED 4 // "IN", watched ports, state size
+
+/************************************************************************/
+/* Typedefs                                                             */
+/************************************************************************/
+
+typedef struct watch_t {
+	port_t *  port;
+	map_io8 * input;   /**< Input register, while redirected */
+	uint8_t   mask;
+	uint8_t   last;    /**< Last recorded levels             */
+	uint8_t   pending; /**< Levels waiting to settle         */
+	uint8_t   stable;  /**< Samples pending has been stable  */
+	void      (*changed)(void);
+} watch_t;
+
+/************************************************************************/
+/* Private function declarations                                        */
+/************************************************************************/
+
+static void on_byte(uint8_t byte);
+static void push(uint8_t kind, uint8_t value);
+static void start_record(void);
+static bool start_replay(void);
+static void stop(void);
+static void record_tick(void);
+static void replay_tick(void);
+static void send_tick(void);
+static void replay_event(uint8_t kind, uint8_t value);
+
+/************************************************************************/
+/* Private variables                                                    */
+/************************************************************************/
+
+static sched_task_t * input_task = NULL;
+static uint8_t *      app_state  = NULL;
+static uint8_t        state_size = 0;
+static void           (*restore_hook)(void) = NULL;
+
+static watch_t          watches[INPUT_PORTS];
+static volatile uint8_t virt[INPUT_PORTS]; // Input registers of the replay
+static uint8_t          n_watches = 0;
+
+static uint8_t  rec[INPUT_BUFFER];
+static uint16_t rec_len = 0;
+static uint16_t pos     = 0;
+static uint32_t last_ms = 0; // Time of the last event recorded or replayed
+static uint16_t last_adc[ADC_CHANNELS];
+static uint8_t  mode    = INPUT_OFF;
+
+static input_stats_t stats = {0};
+
+/************************************************************************/
+/* Function implementations                                             */
+/************************************************************************/
+
+void input_init(sched_task_t * task, void * state, uint8_t size,
+                void (*restore)(void)) {
+	input_task   = task;
+	app_state    = state;
+	state_size   = size > INPUT_STATE_MAX ? INPUT_STATE_MAX : size;
+	restore_hook = restore;
+	input_task->period_ms = INPUT_IDLE_MS;
+}
+
+void input_watch(port_t * port, uint8_t mask, void (*changed)(void)) {
+	if(n_watches == INPUT_PORTS) {
+		return;
+	}
+	watches[n_watches++] = (watch_t){
+		.port = port, .mask = mask, .changed = changed,
+	};
+}
+
+void input_mode(uint8_t m) {
+	stop();
+	switch(m) {
+	case INPUT_RECORD:
+		start_record();
+		break;
+	case INPUT_REPLAY:
+		if(!start_replay()) {
+			m = INPUT_OFF;
+		}
+		break;
+	case INPUT_SEND:
+		pos = 0;
+		break;
+	case INPUT_LOAD:
+		rec_len = 0;
+		break;
+	default:
+		m = INPUT_OFF;
+		break;
+	}
+	mode = m;
+	input_task->period_ms = (m == INPUT_OFF || m == INPUT_LOAD) ?
+	                        INPUT_IDLE_MS : INPUT_TICK_MS;
+	sched_wake(input_task);
+}
+
+void input_load(uint8_t byte) {
+	if(mode == INPUT_LOAD && rec_len < INPUT_BUFFER) {
+		rec[rec_len++] = byte;
+	}
+}
+
+void input_tick(void) {
+	switch(mode) {
+	case INPUT_RECORD:
+		record_tick();
+		break;
+	case INPUT_REPLAY:
+		replay_tick();
+		break;
+	case INPUT_SEND:
+		send_tick();
+		break;
+	default:
+		break;
+	}
+}
+
+void input_stats(input_stats_t * st) {
+	*st = stats;
+}
+
+/************************************************************************/
+/* Private Helpers                                                      */
+/************************************************************************/
+
+/**
+ * USART hook, from the receive interrupt.
+ */
+static void on_byte(uint8_t byte) {
+	push(EV_BYTE, byte);
+}
+
+/**
+ * Appends an event, timestamped from the previous one. The pauses longer
+ * than an event can hold are split over empty events.
+ */
+static void push(uint8_t kind, uint8_t value) {
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		uint32_t now = clock_millis();
+		uint32_t dt  = now - last_ms;
+		while(dt > UINT16_MAX && rec_len + 2 * EV_SIZE <= INPUT_BUFFER) {
+			rec[rec_len++] = 0xff;
+			rec[rec_len++] = 0xff;
+			rec[rec_len++] = EV_NOP;
+			rec[rec_len++] = 0;
+			dt -= UINT16_MAX;
+		}
+		if(rec_len + EV_SIZE > INPUT_BUFFER) {
+			stats.lost++;
+		} else {
+			rec[rec_len++] = dt & 0xff;
+			rec[rec_len++] = dt >> 8;
+			rec[rec_len++] = kind;
+			rec[rec_len++] = value;
+			last_ms = now;
+			stats.recorded++;
+		}
+	}
+}
+
+/**
+ * Writes the snapshot header and starts listening to the USART.
+ */
+static void start_record(void) {
+	rec_len = 0;
+	rec[rec_len++] = 'I';
+	rec[rec_len++] = 'N';
+	rec[rec_len++] = n_watches;
+	rec[rec_len++] = state_size;
+	for(uint8_t i = 0; i < n_watches; i++) {
+		watch_t * w = &watches[i];
+		w->last    = *w->port->input & w->mask;
+		w->pending = w->last;
+		w->stable  = INPUT_SETTLE_MS;
+		rec[rec_len++] = w->last;
+	}
+	adc_snapshot(last_adc);
+	for(uint8_t p = 0; p < ADC_CHANNELS; p++) {
+		rec[rec_len++] = last_adc[p] & 0xff;
+		rec[rec_len++] = last_adc[p] >> 8;
+	}
+	for(uint8_t i = 0; i < state_size; i++) {
+		rec[rec_len++] = app_state[i];
+	}
+
+	last_ms = clock_millis();
+	stats.recorded = 0;
+	stats.lost     = 0;
+	stg_on_byte(on_byte);
+}
+
+/**
+ * Restores the snapshot of the recording and takes over the inputs.
+ * @return false if the recording does not match the watched inputs
+ */
+static bool start_replay(void) {
+	uint16_t hdr = HEADER_FIXED + n_watches + 2 * ADC_CHANNELS + state_size;
+	if(rec_len < hdr || rec[0] != 'I' || rec[1] != 'N' ||
+	   rec[2] != n_watches || rec[3] != state_size) {
+		return false;
+	}
+
+	uint16_t i = HEADER_FIXED + n_watches + 2 * ADC_CHANNELS;
+	for(uint8_t s = 0; s < state_size; s++) {
+		app_state[s] = rec[i++];
+	}
+	if(restore_hook != NULL) {
+		restore_hook();
+	}
+
+	i = HEADER_FIXED;
+	for(uint8_t k = 0; k < n_watches; k++) {
+		watch_t * w = &watches[k];
+		w->input       = w->port->input;
+		virt[k]        = (*w->input & ~w->mask) | (rec[i++] & w->mask);
+		w->port->input = &virt[k];
+	}
+	adc_hold(true);
+	stg_mute(STG_MUTE_INPUT, true);
+	for(uint8_t p = 0; p < ADC_CHANNELS; p++) {
+		adc_set(p, rec[i] | rec[i + 1] << 8);
+		i += 2;
+	}
+	for(uint8_t k = 0; k < n_watches; k++) {
+		if(watches[k].changed != NULL) {
+			ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+				watches[k].changed();
+			}
+		}
+	}
+
+	pos     = hdr;
+	last_ms = clock_millis();
+	stats.replayed = 0;
+	stats.late_ms  = 0;
+	return true;
+}
+
+/**
+ * Gives the inputs back, whatever the mode was.
+ */
+static void stop(void) {
+	if(mode == INPUT_RECORD) {
+		stg_on_byte(NULL);
+	} else if(mode == INPUT_REPLAY) {
+		for(uint8_t k = 0; k < n_watches; k++) {
+			watches[k].port->input = watches[k].input;
+		}
+		adc_hold(false);
+		stg_mute(STG_MUTE_INPUT, false);
+	}
+	mode = INPUT_OFF;
+}
+
+/**
+ * Records the pin changes once they settle, the bounces in between would
+ * fill the recording in a few key presses.
+ */
+static void record_tick(void) {
+	for(uint8_t i = 0; i < n_watches; i++) {
+		watch_t * w = &watches[i];
+		uint8_t   v = *w->port->input & w->mask;
+		if(v != w->pending) {
+			w->pending = v;
+			w->stable  = 0;
+		} else if(w->stable < INPUT_SETTLE_MS && ++w->stable == INPUT_SETTLE_MS &&
+		          v != w->last) {
+			w->last = v;
+			push(EV_PORT | i, v);
+		}
+	}
+
+	uint16_t adc[ADC_CHANNELS];
+	adc_snapshot(adc);
+	for(uint8_t p = 0; p < ADC_CHANNELS; p++) {
+		if(adc[p] != last_adc[p]) {
+			last_adc[p] = adc[p];
+			push(EV_ADC | p << 4 | adc[p] >> 8, adc[p] & 0xff);
+		}
+	}
+}
+
+/**
+ * Replays the events that are due, the timestamps are relative to the
+ * previous event so a late event does not shift the following ones.
+ */
+static void replay_tick(void) {
+	uint32_t now = clock_millis();
+	while(pos + EV_SIZE <= rec_len) {
+		uint16_t dt = rec[pos] | rec[pos + 1] << 8;
+		if(now - last_ms < dt) {
+			return;
+		}
+		last_ms += dt;
+		if(now - last_ms > stats.late_ms) {
+			stats.late_ms = now - last_ms;
+		}
+		replay_event(rec[pos + 2], rec[pos + 3]);
+		pos += EV_SIZE;
+		stats.replayed++;
+	}
+	input_mode(INPUT_OFF);
+}
+
+static void send_tick(void) {
+	while(pos < rec_len) {
+		if(!stg_try_put(rec[pos])) {
+			return;
+		}
+		pos++;
+	}
+	input_mode(INPUT_OFF);
+}
+
+static void replay_event(uint8_t kind, uint8_t value) {
+	if(kind & EV_ADC) {
+		adc_set((kind >> 4) & 0x07, (kind & 0x0f) << 8 | value);
+	} else if(kind == EV_BYTE) {
+		stg_inject(value);
+	} else if(kind < n_watches) {
+		watch_t * w = &watches[kind];
+		virt[kind] = (virt[kind] & ~w->mask) | (value & w->mask);
+		if(w->changed != NULL) {
+			ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+				w->changed();
+			}
+		}
+	}
+}
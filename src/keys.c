@@ -0,0 +1,160 @@
+/************************************************************************/
+/* Includes                                                             */
+/************************************************************************/
+
+#include "keys.h"
+#include "clock.h"
+
+#include <stddef.h>
+#include <util/atomic.h>
+
+/************************************************************************/
+/* Defines                                                              */
+/************************************************************************/
+
+#define RELEASED (1)
+#define PRESSED  (0)
+
+#define SETTLED(db) ((db).samples == 0x00 || (db).samples == 0xff)
+
+/************************************************************************/
+/* Private function declarations                                        */
+/************************************************************************/
+
+static void act(key_t * key, uint8_t idx, uint8_t level);
+
+/************************************************************************/
+/* Private variables                                                    */
+/************************************************************************/
+
+static key_t *        keys_arr  = NULL;
+static uint8_t        n_keys    = 0;
+static key_handler_t  on_key    = NULL;
+static sched_task_t * keys_task = NULL;
+static keys_stats_t   stats     = {0};
+
+/************************************************************************/
+/* Function implementations                                             */
+/************************************************************************/
+
+void keys_init(key_t * keys, uint8_t n, key_handler_t handler,
+               sched_task_t * task) {
+	for(uint8_t i = 0; i < n; i++) {
+		key_t * key = &keys[i];
+		as_input_pull_up_pin(key->pin.port, key->pin.pin);
+		key->db    = (debounce_t)DEBOUNCE_RELEASED;
+		key->acted = RELEASED;
+		key->raw   = RELEASED;
+		key->early = false;
+		key->edge  = false;
+	}
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		keys_arr  = keys;
+		n_keys    = n;
+		on_key    = handler;
+		keys_task = task;
+	}
+}
+
+void keys_pin_change(void) {
+	bool first = false;
+	for(uint8_t i = 0; i < n_keys; i++) {
+		key_t * key = &keys_arr[i];
+		uint8_t raw = read_pin(key->pin.port, key->pin.pin);
+		if(raw == key->raw) {
+			continue;
+		}
+		key->raw = raw;
+		// Bounces within the window are left to the debouncer
+		if(!key->edge) {
+			key->edge    = true;
+			key->edge_us = clock_micros();
+			first        = true;
+		}
+	}
+	if(first && keys_task != NULL) {
+		sched_wake(keys_task);
+	}
+}
+
+void keys_scan(void) {
+	bool busy = false;
+
+	for(uint8_t i = 0; i < n_keys; i++) {
+		key_t * key   = &keys_arr[i];
+		uint8_t level = debounce_pin(&key->db, key->pin);
+
+#if KEYS_EARLY_NOTE_ON
+		if(key->edge && key->acted == RELEASED &&
+		   (key->db.samples & 0x01) == PRESSED) {
+			key->early = true;
+			act(key, i, PRESSED);
+		}
+#endif
+		if(SETTLED(key->db) && key->early) {
+			// The debouncer confirms or reverts the early note-on
+			key->early = false;
+			if(level == RELEASED) {
+				stats.glitches++;
+			}
+		}
+		if(level != key->acted && SETTLED(key->db)) {
+			act(key, i, level);
+		}
+
+		bool idle = false;
+		if(SETTLED(key->db) && level == key->acted) {
+			// An edge seen by the ISR since the last sample keeps the key
+			// busy, clearing it would leave it to the idle poll. Without
+			// the pin change interrupt edge is never set nor raw updated
+			ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+				if(!key->edge || key->raw == level) {
+					key->edge = false;
+					idle      = true;
+				}
+			}
+		}
+		if(!idle) {
+			busy = true;
+		}
+	}
+
+	sched_sleep(busy ? KEYS_SAMPLE_MS : KEYS_IDLE_MS);
+}
+
+void keys_stats(keys_stats_t * st) {
+	*st = stats;
+}
+
+/************************************************************************/
+/* Private Helpers                                                      */
+/************************************************************************/
+
+/**
+ * Passes a new level to the handler, timing the presses started by an
+ * edge from the edge timestamp.
+ */
+static void act(key_t * key, uint8_t idx, uint8_t level) {
+	key->acted = level;
+	on_key(key, idx, level == PRESSED);
+
+	if(level != PRESSED || !key->edge) {
+		return;
+	}
+
+	uint32_t edge_us;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		edge_us = key->edge_us;
+	}
+	uint32_t us = clock_micros() - edge_us;
+	if(us > UINT16_MAX) {
+		us = UINT16_MAX;
+	}
+	stats.presses++;
+	stats.last_us   = us;
+	stats.total_us += us;
+	if(us > stats.max_us) {
+		stats.max_us = us;
+	}
+}
@@ -7,7 +7,11 @@
 #include "delay.h"
 #include "pin_config.h"
 
+#include <util/atomic.h>
+#include <avr/io.h>
+#include <assert.h>
 #include <string.h>
+#include <avr/pgmspace.h>
 
 /************************************************************************/
 /* Defines                                                              */
@@ -17,8 +21,8 @@
 
 #define CONTRAST_DT 400
 
-#define NUM_ROWS    2
-#define NUM_COLS    16
+#define NUM_ROWS    LCD1602A_ROWS
+#define NUM_COLS    LCD1602A_COLS
 
 #define ROW0_OFFSET 0x00
 #define ROW1_OFFSET 0x40
@@ -31,23 +35,91 @@
 #define FUNCTION_SET_4B1L 0x20
 #define FUNCTION_SET_4B2L 0x28
 #define FUNCTION_SET_8B1L 0x30
+#define FUNCTION_SET_8B2L 0x38
 #define SET_CGRAM_ADDR    0x40
 #define SET_DDRAM_ADDR    0x80
 
+#define IS_LONG_COMMAND(c) (((c) & 0xfc) == 0) /**< clear/home, 1.52 ms */
+
+#define FALLBACK_US       2000 /**< Worst case wait without the busy flag */
+#define BF_POLL_US        4    /**< Lower bound of a status read duration */
+#define STROBE_NS         450  /**< E pulse width, > t_DDR = 360 ns         */
+#define STROBE_CYCLES     ((F_CPU / 1000000UL * STROBE_NS + 999) / 1000)
+
+/**
+ * The async engine is clocked by a timer in CTC mode with a /8 prescaler:
+ *   OCRnA = (F_CPU / 1 MHz) * T_tick / 8 - 1
+ * Every tick clocks out one nibble, so a byte takes two ticks, which
+ * covers the 37 us execution time of every command except clear and
+ * return home, that hold the queue for LONG_TICKS.
+ */
+#define TICK_OCR        ((F_CPU / 1000000UL) * LCD1602A_TICK_US / 8 - 1)
+#define TICK_TCCR_B     0x0A /**< CTC mode, /8 prescaler        */
+#define TICK_TIMSK      0x02 /**< Compare match A interrupt     */
+#define LONG_TICKS      (1520 / LCD1602A_TICK_US + 1)
+#define TICKS_PER_MS    (1000 / LCD1602A_TICK_US)
+#define POWER_ON_MS     50   /**< > 40 ms after Vcc rises to 2.7 V  */
+
+#define QUEUE_MASK      (LCD1602A_QUEUE_LEN - 1)
+
+#define ENTRY_DATA      0x01 /**< RS high, the byte goes to DDRAM/CGRAM */
+#define ENTRY_LONG      0x02 /**< Slow command, hold the queue after it */
+#define ENTRY_NIBBLE    0x04 /**< Single transfer, used by the init     */
+#define ENTRY_WAIT      0x08 /**< No transfer, hold the queue val ms    */
+
 /************************************************************************/
 /* Private function declarations                                        */
 /************************************************************************/
 
 static void forward_data(const lcd1602a_t * lcd);
+static bool bus_8bit(const lcd1602a_t * lcd);
+static void write_byte(const lcd1602a_t * lcd, uint8_t val);
+static void setup_pins(const lcd1602a_t * lcd);
+static void init_4bit(const lcd1602a_t * lcd);
+static void init_8bit(const lcd1602a_t * lcd);
 static void init_contrast(const timer_t * t);
 static void send_command(const lcd1602a_t * lcd, unsigned char cmd);
 static void send_data(const lcd1602a_t * lcd, unsigned char cmd);
+static void enqueue(uint8_t flags, uint8_t val);
+static void wait_ready(const lcd1602a_t * lcd, uint16_t fallback_us);
+static uint8_t read_nibble(const lcd1602a_t * lcd);
+static bool busy_poll(const lcd1602a_t * lcd);
+
+/************************************************************************/
+/* Typedefs                                                             */
+/************************************************************************/
+
+typedef struct {
+	uint8_t flags;
+	uint8_t val;
+} queue_entry_t;
 
 /************************************************************************/
 /* Private variables                                                    */
 /************************************************************************/
 
-static const uint8_t offsets[] = {ROW0_OFFSET, ROW1_OFFSET};
+static const uint8_t offsets[] PROGMEM = {ROW0_OFFSET, ROW1_OFFSET};
+
+// Set if the busy flag ever failed to clear, e.g. the R/W line is not
+// actually wired: from then on, the fixed delays are used
+static bool bf_timed_out = false;
+
+// Async engine, the queue is written by the caller and read by the ISR
+static const lcd1602a_t * async_lcd   = NULL;
+static const timer_t    * async_timer = NULL;
+
+static queue_entry_t    queue[LCD1602A_QUEUE_LEN];
+static volatile uint8_t  q_head  = 0;
+static volatile uint8_t  q_tail  = 0;
+static volatile uint16_t hold    = 0;
+static bool              hold_bf = false; // hold can end on busy flag
+static bool              lo_half = false;
+
+static lcd1602a_stats_t stats    = {0};
+
+#if (LCD1602A_QUEUE_LEN & QUEUE_MASK) != 0 || LCD1602A_QUEUE_LEN > 128
+#error LCD1602A_QUEUE_LEN must be a power of 2, up to 128
+#endif
 
 /************************************************************************/
 /* Function implementations                                             */
@@ -55,38 +127,49 @@ static const uint8_t offsets[] = {ROW0_OFFSET, ROW1_OFFSET};
 
 void lcd1602a_init(const lcd1602a_t * lcd, const timer_t * t)
 {
-	as_output_pin(lcd->ctl_port, lcd->register_sel);
-	as_output_pin(lcd->ctl_port, lcd->enable);
-	setup_with_mask(lcd->bus_port, 0xf0);
+	setup_pins(lcd);
 
-	// Pull the rs pin down and wait for
-	// more than 40ms at init time
-	clear_pin(lcd->ctl_port, lcd->register_sel);
+	// Wait for more than 40ms at init time
 	delay_ms(2000);
 
-	// Set the interface to 8-bit waiting > 4.1 ms
-	put_hi_port(lcd->bus_port, FUNCTION_SET_8B1L);
-	forward_data(lcd);
-	delay_ms(16);
+	if(bus_8bit(lcd)) {
+		init_8bit(lcd);
+	} else {
+		init_4bit(lcd);
+	}
 
-	// Set the interface to 8-bit waiting > 100 us
-	put_hi_port(lcd->bus_port, FUNCTION_SET_8B1L);
-	forward_data(lcd);
-	delay_us(400);
+	send_command(lcd, DISPLAY_OFF);
+	send_command(lcd, CLEAR_DISPLAY);
+	send_command(lcd, ENTRY_SET_DEF_LAT);
 
-	// Set the interface to 8-bit waiting > 100 us
-	put_hi_port(lcd->bus_port, FUNCTION_SET_8B1L);
-	forward_data(lcd);
-	delay_us(400);
+	if(t != NULL) {
+		init_contrast(t);
+	}
+}
 
-	// Set the interface to 4-bit 1 line waiting > 100 us
-	put_hi_port(lcd->bus_port, FUNCTION_SET_4B1L);
-	forward_data(lcd);
-	delay_us(160);
+void lcd1602a_init_async(const lcd1602a_t * lcd, const timer_t * t,
+                         const timer_t * tick)
+{
+	setup_pins(lcd);
+	lcd1602a_async_init(lcd, tick);
+
+	// Same sequence as the blocking init, with the waits timed by the
+	// engine instead of the cpu
+	enqueue(ENTRY_WAIT, POWER_ON_MS);
+	enqueue(ENTRY_NIBBLE, FUNCTION_SET_8B1L);
+	enqueue(ENTRY_WAIT, 5);
+	enqueue(ENTRY_NIBBLE, FUNCTION_SET_8B1L);
+	enqueue(ENTRY_WAIT, 1);
+	enqueue(ENTRY_NIBBLE, FUNCTION_SET_8B1L);
+	enqueue(ENTRY_WAIT, 1);
+	if(bus_8bit(lcd)) {
+		send_command(lcd, FUNCTION_SET_8B2L);
+	} else {
+		enqueue(ENTRY_NIBBLE, FUNCTION_SET_4B1L);
+		enqueue(ENTRY_WAIT, 1);
+		send_command(lcd, FUNCTION_SET_4B2L);
+	}
 
-	// The lcd is initialized, these last operations
-	// allows the use of the lcd in 4-bit mode with 2 lines
-	send_command(lcd, FUNCTION_SET_4B2L);
 	send_command(lcd, DISPLAY_OFF);
 	send_command(lcd, CLEAR_DISPLAY);
 	send_command(lcd, ENTRY_SET_DEF_LAT);
@@ -130,7 +213,8 @@ void lcd1602_clear_row(const lcd1602a_t * lcd, uint8_t row)
 
 void lcd1602a_set_cursor(const lcd1602a_t * lcd, uint8_t x, uint8_t y)
 {
-	send_command(lcd, SET_DDRAM_ADDR | ((y % NUM_COLS) + offsets[x % NUM_ROWS]));
+	uint8_t offset = pgm_read_byte(&offsets[x % NUM_ROWS]);
+	send_command(lcd, SET_DDRAM_ADDR | ((y % NUM_COLS) + offset));
 }
 
 void lcd1602a_put_char(const lcd1602a_t * lcd, unsigned char c)
@@ -146,16 +230,127 @@ void lcd1602a_print(const lcd1602a_t * lcd, const char *str)
 
 void lcd1602a_print_row(const lcd1602a_t * lcd, const char *str, uint8_t row)
 {
-	// TODO maybe an option to clear only if the user wants
-	// TODO strlen heavy, maybe change api and pass len?
-	size_t len = strlen(str);
+	// Pad with spaces instead of clearing the row first, so that every
+	// cell gets written exactly once
 	size_t idx = 0;
 
-	lcd1602_clear_row(lcd, row);
 	lcd1602a_set_cursor(lcd, row, 0);
-	for(; (idx < len) && (idx < NUM_COLS); idx++)  {
+	for(; (idx < NUM_COLS) && (str[idx] != '\0'); idx++)  {
 		lcd1602a_put_char(lcd, str[idx]);
 	}
+	for(; idx < NUM_COLS; idx++)  {
+		lcd1602a_put_char(lcd, ' ');
+	}
+}
+
+void lcd1602a_async_init(const lcd1602a_t * lcd, const timer_t * t)
+{
+	*t->tim_sk   = 0;
+	*t->ocr_a_16 = TICK_OCR; // 16-bit register: ocr_a_16 active
+	*t->tccr_a   = 0x00;
+	*t->tccr_b   = TICK_TCCR_B;
+
+	async_timer = t;
+	async_lcd   = lcd;
+}
+
+void lcd1602a_async_tick(void)
+{
+	if(hold != 0) {
+		// With the busy flag the long commands release the queue as soon
+		// as they complete, hold is kept as the timeout
+		bool done = hold_bf && async_lcd->use_busy_flag && !bf_timed_out &&
+		            !busy_poll(async_lcd);
+		if(!done) {
+			hold--;
+			return;
+		}
+		hold = 0;
+	}
+
+	uint8_t tail = q_tail;
+	if(tail == q_head) {
+		*async_timer->tim_sk = 0; // Nothing to do, stop ticking
+		return;
+	}
+
+	const queue_entry_t * e = &queue[tail];
+	if(e->flags & ENTRY_WAIT) {
+		hold    = (uint16_t)e->val * TICKS_PER_MS;
+		hold_bf = false;
+		q_tail  = (tail + 1) & QUEUE_MASK;
+		return;
+	}
+
+	if(!lo_half) {
+		if(e->flags & ENTRY_DATA) {
+			set_pin(async_lcd->ctl_port, async_lcd->register_sel);
+		} else {
+			clear_pin(async_lcd->ctl_port, async_lcd->register_sel);
+		}
+	}
+
+	if(bus_8bit(async_lcd)) {
+		set_port(async_lcd->bus_port, e->val);
+		forward_data(async_lcd);
+	} else if(!lo_half) {
+		put_hi_port(async_lcd->bus_port, e->val & 0xf0);
+		forward_data(async_lcd);
+		if(!(e->flags & ENTRY_NIBBLE)) {
+			lo_half = true;
+			return;
+		}
+	} else {
+		put_hi_port(async_lcd->bus_port, (e->val << 4) & 0xf0);
+		forward_data(async_lcd);
+		lo_half = false;
+	}
+
+	hold    = (e->flags & ENTRY_LONG) ? LONG_TICKS : 0;
+	hold_bf = true;
+	stats.sent++;
+	q_tail  = (tail + 1) & QUEUE_MASK;
+}
+
+bool lcd1602a_idle(void)
+{
+	bool idle;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		idle = q_head == q_tail && hold == 0 && !lo_half;
+	}
+	return idle;
+}
+
+void lcd1602a_stats(lcd1602a_stats_t * st)
+{
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		*st = stats;
+		st->depth = (q_head - q_tail) & QUEUE_MASK;
+	}
+}
+
+uint8_t lcd1602a_read_status(const lcd1602a_t * lcd)
+{
+	if(!lcd->use_busy_flag) {
+		return 0;
+	}
+
+	// With the pull-ups on, a display that does not drive the bus (R/W
+	// not actually wired) reads as always busy and trips the timeout
+	uint8_t mask = bus_8bit(lcd) ? 0xff : 0xf0;
+	set_port_mask(lcd->bus_port, mask);
+	setup_with_cleared_mask(lcd->bus_port, mask);
+	clear_pin(lcd->ctl_port, lcd->register_sel);
+	set_pin(lcd->ctl_port, lcd->read_write);
+
+	uint8_t status = read_nibble(lcd);
+	if(!bus_8bit(lcd)) {
+		status |= read_nibble(lcd) >> 4;
+	}
+
+	clear_pin(lcd->ctl_port, lcd->read_write);
+	setup_with_mask(lcd->bus_port, mask);
+	return status;
 }
 
 #define MAP_SIZE (8)
@@ -174,6 +369,14 @@ void lcd1602a_new_char(const lcd1602a_t * lcd, uint8_t id, const char map[8]) {
 	}
 }
 
+void lcd1602a_new_char_P(const lcd1602a_t * lcd, uint8_t id, const char map[8]) {
+	id &= 7;
+	send_command(lcd, SET_CGRAM_ADDR | id << 3);
+	for(uint8_t i = 0; i < MAP_SIZE; i++) {
+		send_data(lcd, pgm_read_byte(&map[i]));
+	}
+}
+
 /************************************************************************/
 /* Private Helpers                                                      */
 /************************************************************************/
@@ -184,32 +387,245 @@ void lcd1602a_new_char(const lcd1602a_t * lcd, uint8_t id, const char map[8]) {
  */
 static void send_command(const lcd1602a_t * lcd, unsigned char cmd)
 {
+	if(async_lcd != NULL) {
+		enqueue(IS_LONG_COMMAND(cmd) ? ENTRY_LONG : 0, cmd);
+		return;
+	}
+
 	clear_pin(lcd->ctl_port, lcd->register_sel);
+	write_byte(lcd, cmd);
+	wait_ready(lcd, FALLBACK_US);
+}
+
+/**
+ * Sends a command to the lcd display
+ * @param cmd the command to actuate
+ */
+static void send_data(const lcd1602a_t * lcd, unsigned char cmd)
+{
+	if(async_lcd != NULL) {
+		enqueue(ENTRY_DATA, cmd);
+		return;
+	}
 
-	put_hi_port(lcd->bus_port, cmd & 0xf0);
+	set_pin(lcd->ctl_port, lcd->register_sel);
+	write_byte(lcd, cmd);
+	wait_ready(lcd, FALLBACK_US);
+}
+
+/**
+ * Pushes a byte in the async queue, waiting for a free slot if the
+ * queue is full. If interrupts are disabled the engine is ticked from
+ * here, so that a full queue can never deadlock the caller.
+ */
+static void enqueue(uint8_t flags, uint8_t val)
+{
+	uint8_t head = q_head;
+	uint8_t next = (head + 1) & QUEUE_MASK;
+
+	if(next == q_tail) {
+		stats.stalls++;
+		while(next == q_tail) {
+			if(!(SREG & (1 << SREG_I))) {
+				delay_us(LCD1602A_TICK_US);
+				lcd1602a_async_tick();
+			}
+		}
+	}
+
+	queue[head].flags = flags;
+	queue[head].val   = val;
+	q_head = next;
+
+	uint8_t depth = (next - q_tail) & QUEUE_MASK;
+	if(depth > stats.max_depth) {
+		stats.max_depth = depth;
+	}
+	*async_timer->tim_sk = TICK_TIMSK;
+}
+
+/**
+ * Waits for the controller to complete the last operation. The busy
+ * flag is polled if the R/W line is available, with the fixed delay
+ * acting as the timeout, otherwise the fixed delay is waited.
+ * @param fallback_us the worst case duration of the operation
+ */
+static void wait_ready(const lcd1602a_t * lcd, uint16_t fallback_us)
+{
+	if(!lcd->use_busy_flag || bf_timed_out) {
+		delay_us(fallback_us);
+		return;
+	}
+
+	for(uint16_t elapsed = 0; elapsed < fallback_us; elapsed += BF_POLL_US) {
+		if(!(lcd1602a_read_status(lcd) & LCD1602A_BUSY_FLAG)) {
+			return;
+		}
+	}
+	bf_timed_out = true;
+}
+
+/**
+ * Clocks a nibble (or a byte, in 8-bit mode) out of the display, the bus
+ * must be in read mode
+ * @return the nibble, in the high half of the byte
+ */
+static INLINED
+uint8_t read_nibble(const lcd1602a_t * lcd)
+{
+	set_pin(lcd->ctl_port, lcd->enable);
+	delay_us(1); // t_DDR = 360 ns
+	uint8_t nibble = read_port_mask(lcd->bus_port, bus_8bit(lcd) ? 0xff : 0xf0);
+	clear_pin(lcd->ctl_port, lcd->enable);
+	delay_us(1);
+	return nibble;
+}
+
+/**
+ * Reads the busy flag once, for the async tick: it runs in the timer ISR,
+ * so unlike lcd1602a_read_status the E pulses only last STROBE_CYCLES,
+ * without the delay_us calls, and the address counter is dropped. The bus
+ * is handed back as outputs, with RS and R/W low.
+ * @return true if the controller is still busy
+ */
+static bool busy_poll(const lcd1602a_t * lcd)
+{
+	uint8_t mask = bus_8bit(lcd) ? 0xff : 0xf0;
+	set_port_mask(lcd->bus_port, mask);
+	setup_with_cleared_mask(lcd->bus_port, mask);
+	clear_pin(lcd->ctl_port, lcd->register_sel);
+	set_pin(lcd->ctl_port, lcd->read_write);
+
+	set_pin(lcd->ctl_port, lcd->enable);
+	__builtin_avr_delay_cycles(STROBE_CYCLES);
+	bool busy = read_port_mask(lcd->bus_port, mask) & LCD1602A_BUSY_FLAG;
+	clear_pin(lcd->ctl_port, lcd->enable);
+	if(!bus_8bit(lcd)) {
+		// The low nibble is clocked out too, or the next read is shifted
+		__builtin_avr_delay_cycles(STROBE_CYCLES);
+		set_pin(lcd->ctl_port, lcd->enable);
+		__builtin_avr_delay_cycles(STROBE_CYCLES);
+		clear_pin(lcd->ctl_port, lcd->enable);
+	}
+
+	clear_pin(lcd->ctl_port, lcd->read_write);
+	setup_with_mask(lcd->bus_port, mask);
+	return busy;
+}
+
+/**
+ * Tells whether the display is driven through the 8-bit bus. When a
+ * single bus width is compiled in, this folds to a constant and the code
+ * of the other mode is dropped.
+ */
+static INLINED
+bool bus_8bit(const lcd1602a_t * lcd)
+{
+#if LCD1602A_BUS_WIDTH == 8
+	(void)lcd;
+	return true;
+#elif LCD1602A_BUS_WIDTH == 4
+	(void)lcd;
+	return false;
+#else
+	return lcd->bus_mode == LCD1602A_BUS_8BIT;
+#endif
+}
+
+/**
+ * Writes a byte on the bus, in one or two transfers depending on the
+ * bus width. The register select line must already be set.
+ */
+static INLINED
+void write_byte(const lcd1602a_t * lcd, uint8_t val)
+{
+	if(bus_8bit(lcd)) {
+		set_port(lcd->bus_port, val);
+		forward_data(lcd);
+		return;
+	}
+
+	put_hi_port(lcd->bus_port, val & 0xf0);
 	forward_data(lcd);
 
-	put_hi_port(lcd->bus_port, (cmd << 4) & 0xf0);
+	put_hi_port(lcd->bus_port, (val << 4) & 0xf0);
 	forward_data(lcd);
+}
+
+/**
+ * Configures the control and bus lines as outputs, with RS and R/W low
+ */
+static void setup_pins(const lcd1602a_t * lcd)
+{
+	assert(LCD1602A_BUS_WIDTH == 0 ||
+	       (LCD1602A_BUS_WIDTH == 8) == (lcd->bus_mode == LCD1602A_BUS_8BIT));
 
-	delay_us(2000);
+	as_output_pin(lcd->ctl_port, lcd->register_sel);
+	as_output_pin(lcd->ctl_port, lcd->enable);
+	if(lcd->use_busy_flag) {
+		as_output_pin(lcd->ctl_port, lcd->read_write);
+		clear_pin(lcd->ctl_port, lcd->read_write);
+	}
+	if(bus_8bit(lcd)) {
+		as_output_port(lcd->bus_port);
+	} else {
+		setup_with_mask(lcd->bus_port, 0xf0);
+	}
+	clear_pin(lcd->ctl_port, lcd->register_sel);
 }
 
 /**
- * Sends a command to the lcd display
- * @param cmd the command to actuate
+ * Initialization by instruction for the 4-bit interface, as described by
+ * figure 24 of the HD44780U datasheet. Only the high nibble is wired, so
+ * the first function sets are single transfers.
  */
-static void send_data(const lcd1602a_t * lcd, unsigned char cmd)
+static void init_4bit(const lcd1602a_t * lcd)
 {
-	set_pin(lcd->ctl_port, lcd->register_sel);
+	// Set the interface to 8-bit waiting > 4.1 ms
+	put_hi_port(lcd->bus_port, FUNCTION_SET_8B1L);
+	forward_data(lcd);
+	delay_ms(16);
 
-	put_hi_port(lcd->bus_port, cmd & 0xf0);
+	// Set the interface to 8-bit waiting > 100 us
+	put_hi_port(lcd->bus_port, FUNCTION_SET_8B1L);
 	forward_data(lcd);
+	delay_us(400);
 
-	put_hi_port(lcd->bus_port, (cmd << 4) & 0xf0);
+	// Set the interface to 8-bit waiting > 100 us
+	put_hi_port(lcd->bus_port, FUNCTION_SET_8B1L);
 	forward_data(lcd);
+	delay_us(400);
+
+	// Set the interface to 4-bit 1 line waiting > 100 us
+	put_hi_port(lcd->bus_port, FUNCTION_SET_4B1L);
+	forward_data(lcd);
+	delay_us(160);
+
+	// The interface is now 4-bit, set the number of lines
+	send_command(lcd, FUNCTION_SET_4B2L);
+}
+
+/**
+ * Initialization by instruction for the 8-bit interface, as described by
+ * figure 23 of the HD44780U datasheet.
+ */
+static void init_8bit(const lcd1602a_t * lcd)
+{
+	// Set the interface to 8-bit waiting > 4.1 ms
+	set_port(lcd->bus_port, FUNCTION_SET_8B1L);
+	forward_data(lcd);
+	delay_ms(16);
+
+	// Set the interface to 8-bit waiting > 100 us
+	forward_data(lcd);
+	delay_us(400);
+
+	// Set the interface to 8-bit waiting > 100 us
+	forward_data(lcd);
+	delay_us(400);
 
-	delay_us(2000);
+	// The interface is 8-bit from the start, set the number of lines
+	send_command(lcd, FUNCTION_SET_8B2L);
 }
 
 /**
@@ -0,0 +1,64 @@
+/************************************************************************/
+/* Includes                                                             */
+/************************************************************************/
+
+#include "lcd_fb.h"
+
+#include <string.h>
+
+/************************************************************************/
+/* Defines                                                              */
+/************************************************************************/
+
+#define CURSOR_UNKNOWN (0xff)
+
+/************************************************************************/
+/* Function implementations                                             */
+/************************************************************************/
+
+void lcd_fb_init(lcd_fb_t * fb, const lcd1602a_t * lcd) {
+	fb->lcd = lcd;
+	memset(fb->back, ' ', sizeof(fb->back));
+	memset(fb->front, ' ', sizeof(fb->front));
+	lcd1602a_clear(lcd);
+}
+
+void lcd_fb_print_row(lcd_fb_t * fb, const char * str, uint8_t row) {
+	char * dst = fb->back[row % LCD1602A_ROWS];
+	uint8_t col = 0;
+	for(; col < LCD1602A_COLS && str[col] != '\0'; col++) {
+		dst[col] = str[col];
+	}
+	for(; col < LCD1602A_COLS; col++) {
+		dst[col] = ' ';
+	}
+}
+
+void lcd_fb_put_char(lcd_fb_t * fb, uint8_t row, uint8_t col, char c) {
+	fb->back[row % LCD1602A_ROWS][col % LCD1602A_COLS] = c;
+}
+
+uint8_t lcd_fb_flush(lcd_fb_t * fb) {
+	uint8_t sent = 0;
+
+	for(uint8_t row = 0; row < LCD1602A_ROWS; row++) {
+		// The cursor position is unknown at every flush start (other users
+		// may have moved it) and the address counter does not wrap from
+		// the end of row 0 to the start of row 1
+		uint8_t cursor = CURSOR_UNKNOWN;
+		for(uint8_t col = 0; col < LCD1602A_COLS; col++) {
+			char c = fb->back[row][col];
+			if(c == fb->front[row][col]) {
+				continue;
+			}
+			if(cursor != col) {
+				lcd1602a_set_cursor(fb->lcd, row, col);
+			}
+			lcd1602a_put_char(fb->lcd, c);
+			fb->front[row][col] = c;
+			cursor = col + 1;
+			sent++;
+		}
+	}
+	return sent;
+}
@@ -1,7 +1,24 @@
 #include <lcd_1602a.h>
 #include <ay38910a.h>
 #include <settings.h>
+#include <presets.h>
+#include <adc.h>
+#include <meter.h>
+#include <diag.h>
+#include <clock.h>
+#include <sched.h>
+#include <keys.h>
+#include <seq.h>
+#include <dump.h>
+#include <arp.h>
+#include <mod.h>
+#include <drums.h>
+#include <patch.h>
+#include <capture.h>
+#include <input.h>
 #include <avr/interrupt.h>
+#include <stddef.h>
+#include <avr/pgmspace.h>
 
 
 #define SIZE(x) ((uint8_t)(sizeof(x)/sizeof(x[0])))
@@ -13,6 +30,19 @@ static port_t lcd_bus_port  = IO_PORT_C;
 static port_t lcd_ctl_port  = IO_PORT_C;
 #endif
 
+static const timer_t * timer0 = &(timer_t) {
+	.tccr_a     = &TCCR0A,
+	.tccr_b     = &TCCR0B,
+	.tim_sk     = &TIMSK0,
+	.ocr_a_8    = &OCR0A,
+	.tcnt_8     = &TCNT0,
+	.tif_r      = &TIFR0,
+#if defined(__AVR_ATmega2560__)
+	.ocr_a_port = &(port_t) IO_PORT_B,
+	.ocr_a_pin  = 7,
+#endif
+};
+
 static const timer_t * timer2 = &(timer_t) {
 	.tccr_a     = &TCCR2A,
 	.tccr_b     = &TCCR2B,
@@ -36,32 +66,61 @@ static const timer_t * timer5 = &(timer_t) {
 	.ocr_a_pin = 3,
 };
 
+static const timer_t * timer3 = &(timer_t) {
+	.tccr_a     = &TCCR3A,
+	.tccr_b     = &TCCR3B,
+	.tim_sk     = &TIMSK3,
+	.ocr_a_16   = &OCR3A,
+	.ocr_a_port = &(port_t)IO_PORT_E,
+	.ocr_a_pin  = 3,
+};
+
 static const ay38910a_t * ay = &(ay38910a_t) {
 #if defined(__AVR_ATmega2560__)
 	.bus_port = &(port_t) IO_PORT_A,
 	.ctl_port = &(port_t) IO_PORT_H,
 	.bc1      = 4,
-	.bdir     = 5
+	.bdir     = 5,
 #elif defined(__AVR_ATmega644__)
 	.bus_port = &port_a,
 	.ctl_port = &port_c,
 	.bc1      = 7,
-	.bdir     = 6
+	.bdir     = 6,
 #endif
+	.regs     = (uint8_t[AY38910A_REGS]){0},
 };
 
 static const lcd1602a_t * lcd = &(lcd1602a_t) {
-	.ctl_port     = &lcd_ctl_port,
-	.bus_port     = &lcd_bus_port,
-	.register_sel = 0,
-	.enable       = 1
+	.ctl_port      = &lcd_ctl_port,
+	.bus_port      = &lcd_bus_port,
+	.bus_mode      = LCD1602A_BUS_4BIT,
+	.register_sel  = 0,
+	.enable        = 1,
+	.read_write    = 2,
+	.use_busy_flag = LCD1602A_USE_BUSY_FLAG,
 };
 
-#ifdef USE_PARALLAX
-extern void play_parallax(const ay38910a_t * ay, const timer_t * timer);
+ISR(TIMER0_COMPA_vect,) {
+	clock_tick();
+}
+
+// The period follows the tick of the playing song
+static sched_task_t * seq_task = &(sched_task_t){
+	.name = "seq", .run = seq_tick, .period_ms = SEQ_IDLE_MS,
+};
 
+#ifdef USE_PARALLAX
 int main(void) {
-	play_parallax(ay, timer2);
+	static uint8_t mixer = 0xff;
+
+	clock_init(timer0);
+	sei();
+
+	ay38910_init(ay, timer2);
+	seq_init(ay, &mixer, seq_task);
+	sched_add(seq_task);
+	seq_play(&song_parallax);
+	sched_run();
 }
 
 #else
@@ -69,11 +128,6 @@ int main(void) {
 #define UNMAPPED_CHAN ((channel_t)-1)
 
 
-typedef struct {
-	pin_t     pin;
-	channel_t chan;
-} key_t;
-
 static key_t keys[] = {
 #if defined(__AVR_ATmega2560__)
 	{{.port=&key_port1, .pin=0}, .chan=UNMAPPED_CHAN},
@@ -100,89 +154,412 @@ static settings_t * settings = &(settings_t){
 	.amplitude = AMP_DEF,
 	.octave    = OCT_DEF,
 	.env_shape = SHP_DEF,
+	.arp_rate  = ARP_RATE_DEF,
 };
 
+static lcd_fb_t fb;
+static uint8_t  chan_state = 0xff;
+static bool     drum_keys  = false; // The first keys hit the kit pieces
+
+static const song_t * const songs[] PROGMEM = {
+	&song_parallax,
+};
+
+static const dump_t * const dumps[] PROGMEM = {
+	&dump_demo,
+};
+
+// The sound of the keys: the settings, or a patch picked over serial
+static patch_t sound = {
+	.glide_ms  = MOD_GLIDE_MS,
+	.vib_hz    = MOD_VIB_HZ,
+	.vib_depth = MOD_VIB_DEPTH,
+};
+
+#define PATCH_VOICES(a, n) {{(a), (n)}, {(a), (n)}, {(a), (n)}}
+
+static const patch_t patches[] PROGMEM = {
+	{ // Lead, with a deep vibrato
+		.voices = PATCH_VOICES(12, false),
+		.glide_ms = 30, .vib_hz = 6, .vib_depth = 12,
+	},
+	{ // Noisy tones
+		.voices = PATCH_VOICES(11, true), .noise = 8,
+	},
+	{ // Slow triangle pad
+		.voices = PATCH_VOICES(AMPL_ENV_ENABLE, false),
+		.env_shape = TRIANGULAR, .env_period = 2000,
+		.glide_ms = 80, .vib_hz = 4, .vib_depth = 4,
+	},
+	{ // Buzzer bass
+		.voices = PATCH_VOICES(AMPL_ENV_ENABLE, false),
+		.env_shape = SAWTOOTH, .buzzer = true,
+	},
+};
+
+ISR(TIMER3_COMPA_vect,) {
+	lcd1602a_async_tick();
+}
+
+
+// B = 0, but when idx is 0, this is a C, hence the +1
+#define KEY_NOTE(idx) NOTE((idx)+1, settings->octave)
 
-void play_note(key_t * key, uint8_t note, uint8_t * state) {
+/**
+ * The buzzer shapes tie the envelope to the note, without modulations:
+ * the tone period has to stay locked to the envelope one.
+ */
+void play_voice(channel_t chan, uint8_t note) {
+	if(sound.buzzer) {
+		ay38910_play_buzzer(ay, chan, sound.env_shape, note);
+	} else {
+		mod_note_on(chan, note);
+	}
+}
+
+void play_note(key_t * key, uint8_t idx, uint8_t * state) {
 	for(uint8_t i = 0; i < CHANNEL_NUM; i++) {
-		if((*state) & (1 << i)) {
+		// A channel stolen by a hit is not free before the hit ends, even
+		// if its note was released: the hit would restore the old tone
+		if(((*state) & (1 << i)) && !drums_borrowed(i << 1)) {
 			*state &= CHAN_ENABLE(i);
 			ay38910_channel_mode(ay, *state);
-			ay38910_set_amplitude(ay, i << 1, settings->amplitude);
-
-			// B = 0, but when note is 0, this is a C, hence the +1
-			ay38910_play_note(ay, i << 1, NOTE(note+1, settings->octave));
+			ay38910_set_amplitude(ay, i << 1, patch_amp(i << 1));
+			play_voice(i << 1, KEY_NOTE(idx));
 			key->chan = i;
+			diag_set_once(DIAG_BOOT_FIRST_NOTE, clock_micros());
 			return;
 		}
 	}
+
+	// No free voice left: the last channel arpeggiates the extra notes
+	channel_t last = CHANNEL_NUM - 1;
+	if(!arp_owns(last << 1)) {
+		uint8_t owner = 0;
+		while(owner < SIZE(keys) && keys[owner].chan != last) {
+			owner++;
+		}
+		if(owner == SIZE(keys)) {
+			return; // Not a key voice
+		}
+		mod_note_off(last << 1);
+		arp_add(last << 1, owner, KEY_NOTE(owner));
+	}
+	if(arp_add(last << 1, idx, KEY_NOTE(idx))) {
+		key->chan = last;
+	}
 }
 
-void close_channel(key_t * key, uint8_t * state) {
+void close_channel(key_t * key, uint8_t idx, uint8_t * state) {
+	if(arp_owns(key->chan << 1) && arp_remove(idx) > 0) {
+		key->chan = UNMAPPED_CHAN;
+		return;
+	}
+	mod_note_off(key->chan << 1);
 	*state |= CHAN_DISABLE(key->chan);
 	ay38910_set_amplitude(ay, 1 << key->chan, 0);
 	ay38910_channel_mode(ay, *state);
 	key->chan = UNMAPPED_CHAN;
 }
 
+/**
+ * Maps the envelope knob over the 16-bit envelope period.
+ */
+uint16_t env_period(void) {
+	return (adc_get(ADC_POT_ENV_PERIOD) << (16 - ADC_BITS)) + 1;
+}
+
+/**
+ * Turns the settings into the sound of the keys, the noise and the
+ * modulations of the current sound are kept.
+ */
 void apply_filter(void) {
 	if(settings->env_shape == 0) {
 		settings->amplitude &= AMPL_ENV_DISABLE;
-		stg_print_shape(lcd, settings);
 	} else {
-		uint8_t shape_value = stg_get_shape_value(settings);
 		settings->amplitude |= AMPL_ENV_ENABLE;
-		ay38910_set_envelope(ay, shape_value, 1000);
-		stg_print_shape(lcd, settings);
 	}
+	for(uint8_t i = 0; i < CHANNEL_NUM; i++) {
+		sound.voices[i].amp = settings->amplitude;
+	}
+	sound.env_shape  = stg_get_shape_value(settings);
+	sound.env_period = env_period();
+	sound.buzzer     = stg_is_buzzer(settings);
+	patch_apply(&sound);
+	stg_print_shape(&fb, settings);
 }
 
-const char b_slash[] = {0, 0x10, 0x8, 0x4, 0x2, 0x1, 0, 0};
-const char overline[] = {0x1f, 0, 0, 0, 0, 0, 0, 0};
+void on_key(key_t * key, uint8_t idx, bool pressed) {
+	if(drum_keys && idx < DRUM_PIECES) {
+		if(pressed) {
+			drums_hit(idx);
+		}
+		return;
+	}
+	if(pressed && key->chan == UNMAPPED_CHAN) {
+		play_note(key, idx, &chan_state);
+	} else if(!pressed && key->chan != UNMAPPED_CHAN) {
+		close_channel(key, idx, &chan_state);
+	}
+}
 
-int main(void) {
-	lcd1602a_init(lcd, timer5);
-	lcd1602a_display_on(lcd);
-	lcd1602a_clear(lcd);
-	lcd1602a_home(lcd);
+/**
+ * Enables the pin change interrupts of the key pins
+ */
+void key_pcint_init(void) {
+#if defined(__AVR_ATmega2560__)
+	PCMSK2 = 0xff; // PCINT16-23 on PORTK, keys 0-7
+	PCMSK0 = 0x0f; // PCINT0-3 on PORTB, keys 8-11
+	PCICR |= (1 << PCIE2) | (1 << PCIE0);
+#endif
+}
 
-	lcd1602a_new_char(lcd, 6, overline);
-	lcd1602a_new_char(lcd, 7, b_slash);
+ISR(PCINT0_vect,) {
+	keys_pin_change();
+}
 
-	ay38910_init(ay, timer2);
-	stg_init(sctl);
+ISR(PCINT2_vect,) {
+	keys_pin_change();
+}
 
-	for(int i = 0; i < SIZE(keys); i++) {
-		as_input_pull_up_pin(keys[i].pin.port, keys[i].pin.pin);
+/**
+ * UI task: menu, potentiometers and lcd refresh
+ */
+void update_ui(void) {
+	if(stg_menu_loop(&fb, sctl, settings)) {
+		apply_filter();
+		arp_set_rate(settings->arp_rate);
+		preset_save(PRESET_WORKING, settings);
 	}
 
-	uint8_t state   = 0xff;
+	uint8_t pots = adc_changed();
+	if((pots & (1 << ADC_POT_ENV_PERIOD)) && !sound.buzzer) {
+		// Without the envelope the period is not in the delta
+		sound.env_period = env_period();
+		patch_apply(&sound);
+	}
 
-	stg_print_settings(lcd, settings);
-	stg_print_shape(lcd, settings);
+	lcd_fb_flush(&fb);
+	if(lcd1602a_idle()) {
+		diag_set_once(DIAG_BOOT_LCD_READY, clock_micros());
+	}
+}
 
-	for(;;) {
-		if(stg_received_data()) {
-			stg_update_from_frame(settings);
-			stg_send_frame(settings);
-			stg_print_settings(lcd, settings);
-			apply_filter();
-		}
+/**
+ * Applies the settings restored for an input replay, from a clean state:
+ * what plays and the modulations would make every replay different.
+ */
+void restore_settings(void) {
+	seq_stop();
+	dump_stop();
+	drums_stop();
+	arp_reset();
+	mod_reset();
+	stg_print_settings(&fb, settings);
+	apply_filter();
+	arp_set_rate(settings->arp_rate);
+}
 
-		if(stg_menu_loop(lcd, sctl, settings)) {
-			apply_filter();
-		}
+void draw_meter(void) {
+	if(stg_meter_shown()) {
+		meter_draw(&fb, ay);
+	}
+}
 
-		for(int i = 0; i < SIZE(keys); i++) {
-			key_t * key = &keys[i];
-			uint8_t pressed = read_debounced(keys[i].pin) == 0x00;
-			if(pressed && key->chan == UNMAPPED_CHAN) {
-				play_note(key, i, &state);
-			} else if(!pressed && key->chan != UNMAPPED_CHAN) {
-				close_channel(key, &state);
-			}
+/**
+ * Serial task: settings, preset and diagnostics frames
+ */
+void handle_serial(void) {
+	if(!stg_received_data()) {
+		return;
+	}
+
+	uint8_t arg;
+	switch(stg_frame_command(&arg)) {
+	case FRAME_QUERY:
+		diag_report((char)arg, stg_write);
+		stg_frame_done();
+		return;
+	case FRAME_SONG_PLAY:
+		if(arg < SIZE(songs)) {
+			dump_stop();
+			seq_play((const song_t *)pgm_read_word(&songs[arg]));
+		}
+		stg_frame_done();
+		return;
+	case FRAME_DUMP_PLAY:
+		if(arg < SIZE(dumps)) {
+			seq_stop();
+			dump_play((const dump_t *)pgm_read_word(&dumps[arg]));
+		}
+		stg_frame_done();
+		return;
+	case FRAME_DRUM_HIT:
+		drums_hit(arg);
+		stg_frame_done();
+		return;
+	case FRAME_DRUM_KEYS:
+		drum_keys = arg == 1;
+		stg_frame_done();
+		return;
+	case FRAME_PATCH_APPLY:
+		if(arg < SIZE(patches)) {
+			memcpy_P(&sound, &patches[arg], sizeof(sound));
+			patch_apply(&sound);
 		}
+		stg_frame_done();
+		return;
+	case FRAME_CAPTURE:
+		stg_frame_done();
+		capture_mode(arg);
+		return;
+	case FRAME_INPUT_MODE:
+		stg_frame_done();
+		input_mode(arg);
+		return;
+	case FRAME_INPUT_BYTE:
+		input_load(arg);
+		stg_frame_done();
+		return;
+	case FRAME_SONG_STOP:
+		seq_stop();
+		dump_stop();
+		stg_frame_done();
+		return;
+	case FRAME_INVALID:
+		stg_frame_done();
+		return;
+	case FRAME_PRESET_SAVE:
+		preset_save(arg, settings);
+		break;
+	case FRAME_PRESET_LOAD:
+		preset_load(arg, settings);
+		break;
+	default:
+		stg_update_from_frame(settings);
+		break;
 	}
+	stg_send_frame(settings);
+	stg_print_settings(&fb, settings);
+	apply_filter();
+	arp_set_rate(settings->arp_rate);
+	preset_save(PRESET_WORKING, settings);
+}
+
+// Woken by the first edge of a key, then paced by keys_scan itself
+static sched_task_t * keys_task = &(sched_task_t){
+	.name = "keys", .run = keys_scan, .period_ms = KEYS_SAMPLE_MS,
+};
+
+static sched_task_t * ui_task = &(sched_task_t){
+	.name = "ui", .run = update_ui, .period_ms = 5,
+};
+
+static sched_task_t * meter_task = &(sched_task_t){
+	.name = "meter", .run = draw_meter, .period_ms = 1000 / METER_FPS,
+};
+
+// Woken by the USART when a frame is complete, the period is a fallback
+static sched_task_t * serial_task = &(sched_task_t){
+	.name = "serial", .run = handle_serial, .period_ms = 100,
+};
+
+// The period follows the frame of the playing dump
+static sched_task_t * dump_task = &(sched_task_t){
+	.name = "dump", .run = dump_frame, .period_ms = DUMP_IDLE_MS,
+};
+
+// The period follows the arpeggio rate while the arpeggio runs
+static sched_task_t * arp_task = &(sched_task_t){
+	.name = "arp", .run = arp_step, .period_ms = 1000 / ARP_RATE_DEF,
+};
+
+// Runs every MOD_TICK_MS while a channel is modulated
+static sched_task_t * mod_task = &(sched_task_t){
+	.name = "mod", .run = mod_tick, .period_ms = MOD_TICK_MS,
+};
+
+// Runs every DRUMS_TICK_MS while a hit is playing
+static sched_task_t * drums_task = &(sched_task_t){
+	.name = "drums", .run = drums_tick, .period_ms = DRUMS_IDLE_MS,
+};
+
+// Sends the capture stream every CAPTURE_TX_MS while there is one
+static sched_task_t * capture_task = &(sched_task_t){
+	.name = "capture", .run = capture_send, .period_ms = CAPTURE_IDLE_MS,
+};
+
+// Samples or replays the inputs every INPUT_TICK_MS while it runs
+static sched_task_t * input_task = &(sched_task_t){
+	.name = "input", .run = input_tick, .period_ms = INPUT_IDLE_MS,
+};
+
+void wake_serial(void) {
+	sched_wake(serial_task);
+}
+
+static const char b_slash[] PROGMEM = {0, 0x10, 0x8, 0x4, 0x2, 0x1, 0, 0};
+static const char overline[] PROGMEM = {0x1f, 0, 0, 0, 0, 0, 0, 0};
+
+int main(void) {
+	// The clock times the boot, it needs the interrupts from the start
+	clock_init(timer0);
+	sei();
+
+	// Fast boot: the PSG and the keys come up first, muted, the lcd power
+	// on and init waits are then run by its async engine in background
+	ay38910_init(ay, timer2);
+	ay38910_channel_mode(ay, chan_state);
+
+	keys_init(keys, SIZE(keys), on_key, keys_task);
+	seq_init(ay, &chan_state, seq_task);
+	dump_init(ay, &chan_state, dump_task);
+	arp_init(ay, arp_task);
+	mod_init(ay, mod_task);
+	drums_init(ay, &chan_state, drums_task);
+	patch_init(ay, &chan_state);
+	capture_init(ay, capture_task);
+	input_init(input_task, settings, sizeof(*settings), restore_settings);
+#if defined(__AVR_ATmega2560__)
+	input_watch(&key_port1, 0xff, keys_pin_change);
+	input_watch(&key_port2, 0x0f, keys_pin_change);
+#endif
+	input_watch(sctl->nav_pin.port, 1 << sctl->nav_pin.pin, NULL);
+	input_watch(sctl->sel_pin.port, 1 << sctl->sel_pin.pin, NULL);
+	key_pcint_init();
+
+	preset_init();
+	preset_load(PRESET_WORKING, settings);
+	arp_set_rate(settings->arp_rate);
+	stg_on_frame(wake_serial);
+	stg_init(sctl);
+
+	lcd1602a_init_async(lcd, timer5, timer3);
+	lcd1602a_display_on(lcd);
+	lcd_fb_init(&fb, lcd);
+	lcd1602a_home(lcd);
+
+	lcd1602a_new_char_P(lcd, 6, overline);
+	lcd1602a_new_char_P(lcd, 7, b_slash);
+	meter_init(lcd);
+
+	stg_print_settings(&fb, settings);
+	apply_filter();
+
+	diag_set_once(DIAG_BOOT_KEYS_READY, clock_micros());
+
+	sched_add(keys_task);
+	sched_add(ui_task);
+	sched_add(meter_task);
+	sched_add(serial_task);
+	sched_add(seq_task);
+	sched_add(dump_task);
+	sched_add(arp_task);
+	sched_add(mod_task);
+	sched_add(drums_task);
+	sched_add(capture_task);
+	sched_add(input_task);
+	sched_run();
 }
 
 #endif
@@ -0,0 +1,109 @@
+/************************************************************************/
+/* Includes                                                             */
+/************************************************************************/
+
+#include "mem.h"
+
+#include <stddef.h>
+#include <avr/io.h>
+
+/************************************************************************/
+/* Defines                                                              */
+/************************************************************************/
+
+#define STR(x)  #x
+#define XSTR(x) STR(x)
+
+/************************************************************************/
+/* Private function declarations                                        */
+/************************************************************************/
+
+static void paint(void) __attribute__((naked, used, section(".init3")));
+static uint8_t * heap_end(void);
+static void fill(mem_stats_t * st, uint8_t * p);
+
+/************************************************************************/
+/* Private variables                                                    */
+/************************************************************************/
+
+// From the linker script: the end of the static data
+extern uint8_t __heap_start;
+// From malloc, the end of the heap, weak so that malloc is not linked in
+extern uint8_t * __brkval __attribute__((weak));
+
+// Next byte of the mem_scan in progress, NULL when none is
+static uint8_t * scan = NULL;
+
+/************************************************************************/
+/* Function implementations                                             */
+/************************************************************************/
+
+void mem_stats(mem_stats_t * st) {
+	uint8_t * p = heap_end();
+	while(p <= (uint8_t *)RAMEND && *p == MEM_CANARY) {
+		p++;
+	}
+	fill(st, p);
+}
+
+bool mem_scan(mem_stats_t * st) {
+	uint8_t * end = heap_end();
+	if(scan == NULL || scan < end) {
+		scan = end;
+	}
+	for(uint8_t n = 0; n < MEM_SCAN_CHUNK; n++) {
+		if(scan > (uint8_t *)RAMEND || *scan != MEM_CANARY) {
+			fill(st, scan);
+			scan = NULL;
+			return true;
+		}
+		scan++;
+	}
+	return false;
+}
+
+/************************************************************************/
+/* Private Helpers                                                      */
+/************************************************************************/
+
+/**
+ * Computes the usage from the first byte above the heap that lost the
+ * paint.
+ */
+static void fill(mem_stats_t * st, uint8_t * p) {
+	uint8_t * end = heap_end();
+	uint8_t * sp  = (uint8_t *)SP;
+
+	st->static_bytes = &__heap_start - (uint8_t *)RAMSTART;
+	st->heap_bytes   = end - &__heap_start;
+	st->stack_bytes  = (uint8_t *)RAMEND - sp;
+	st->stack_max    = (uint8_t *)RAMEND + 1 - p;
+	st->free_bytes   = sp + 1 - end;
+	st->free_min     = p - end;
+}
+
+/**
+ * Paints the SRAM from the end of the static data to RAMEND, before main
+ * and before the stack is used: nothing but registers in here, the C
+ * runtime only sets the stack pointer and r1 before .init3.
+ */
+static void paint(void) {
+	__asm__ volatile(
+		"    ldi r30, lo8(__heap_start)\n"
+		"    ldi r31, hi8(__heap_start)\n"
+		"    ldi r24, " XSTR(MEM_CANARY) "\n"
+		"    ldi r25, hi8(" XSTR(RAMEND) ")\n"
+		"1:  st Z+, r24\n"
+		"    cpi r30, lo8(" XSTR(RAMEND) ")\n"
+		"    cpc r31, r25\n"
+		"    brlo 1b\n"
+		"    breq 1b\n"
+	);
+}
+
+static uint8_t * heap_end(void) {
+	if(&__brkval != NULL && __brkval != NULL) {
+		return __brkval;
+	}
+	return &__heap_start;
+}
@@ -0,0 +1,120 @@
+/************************************************************************/
+/* Includes                                                             */
+/************************************************************************/
+
+#include "meter.h"
+
+#include <avr/pgmspace.h>
+
+/************************************************************************/
+/* Defines                                                              */
+/************************************************************************/
+
+#define BAR_CELLS     (4)
+#define CELL_PIXELS   (5)
+#define BAR_PIXELS    (BAR_CELLS * CELL_PIXELS)
+#define GLYPHS        (CELL_PIXELS)
+
+#define AMP_MASK      (0x0F)
+
+/************************************************************************/
+/* Private function declarations                                        */
+/************************************************************************/
+
+static uint8_t channel_pixels(const ay38910a_t * ay, uint8_t ch, bool * env);
+
+/************************************************************************/
+/* Private variables                                                    */
+/************************************************************************/
+
+/**
+ * Bar glyphs, filled from the left by 1 to 5 pixel columns. The top and
+ * bottom rows are left empty to keep the bars apart from the first row.
+ */
+static const char glyphs[GLYPHS][8] PROGMEM = {
+	{0, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0},
+	{0, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0},
+	{0, 0x1c, 0x1c, 0x1c, 0x1c, 0x1c, 0x1c, 0},
+	{0, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0},
+	{0, 0x1f, 0x1f, 0x1f, 0x1f, 0x1f, 0x1f, 0},
+};
+
+static uint8_t       levels[CHANNEL_NUM] = {0};
+static meter_stats_t stats               = {0};
+
+/************************************************************************/
+/* Function implementations                                             */
+/************************************************************************/
+
+void meter_init(const lcd1602a_t * lcd) {
+	for(uint8_t i = 0; i < GLYPHS; i++) {
+		lcd1602a_new_char_P(lcd, METER_GLYPH_BASE + i, glyphs[i]);
+	}
+}
+
+void meter_draw(lcd_fb_t * fb, const ay38910a_t * ay) {
+	uint8_t col = 0;
+	for(uint8_t ch = 0; ch < CHANNEL_NUM; ch++) {
+		bool env;
+		uint8_t target = channel_pixels(ay, ch, &env);
+		if(target >= levels[ch]) {
+			levels[ch] = target;
+		} else {
+			levels[ch]--;
+		}
+
+		lcd_fb_put_char(fb, METER_ROW, col++, (env ? 'A' : 'a') + ch);
+
+		uint8_t px = levels[ch];
+		for(uint8_t cell = 0; cell < BAR_CELLS; cell++) {
+			char c = ' ';
+			if(px >= CELL_PIXELS) {
+				c = METER_GLYPH_BASE + CELL_PIXELS - 1;
+				px -= CELL_PIXELS;
+			} else if(px > 0) {
+				c = METER_GLYPH_BASE + px - 1;
+				px = 0;
+			}
+			lcd_fb_put_char(fb, METER_ROW, col++, c);
+		}
+	}
+	for(; col < LCD1602A_COLS; col++) {
+		lcd_fb_put_char(fb, METER_ROW, col, ' ');
+	}
+
+	uint8_t cells = lcd_fb_flush(fb);
+	stats.frames++;
+	stats.cells += cells;
+	if(cells > stats.max_cells) {
+		stats.max_cells = cells;
+	}
+}
+
+void meter_stats(meter_stats_t * st) {
+	*st = stats;
+}
+
+/************************************************************************/
+/* Private Helpers                                                      */
+/************************************************************************/
+
+/**
+ * Computes the bar length of a channel from the register shadow.
+ * @param env set if the channel amplitude follows the envelope
+ */
+static uint8_t channel_pixels(const ay38910a_t * ay, uint8_t ch, bool * env) {
+	uint8_t mixer = ay38910_read_shadow(ay, AY38910A_REG_MIXER);
+	uint8_t amp   = ay38910_read_shadow(ay, AY38910A_REG_AMP_A + ch);
+
+	*env = (amp & AMPL_ENV_ENABLE) != 0;
+
+	// A set mixer bit disables the generator
+	bool audible = !(mixer & CHAN_DISABLE((CHA_TONE + ch))) ||
+	               !(mixer & CHAN_DISABLE((CHA_NOISE + ch)));
+	if(!audible) {
+		return 0;
+	}
+
+	uint8_t level = *env ? MAX_AMPL : (amp & AMP_MASK);
+	return (level * BAR_PIXELS + MAX_AMPL / 2) / MAX_AMPL;
+}
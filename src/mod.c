@@ -0,0 +1,192 @@
+/************************************************************************/
+/* Includes                                                             */
+/************************************************************************/
+
+#include "mod.h"
+#include "clock.h"
+#include "drums.h"
+
+#include <stddef.h>
+
+/************************************************************************/
+/* Defines                                                              */
+/************************************************************************/
+
+#define MOD_IDLE_MS 100 // Task period while no channel is modulated
+#define TICK_HZ     (1000 / MOD_TICK_MS)
+#define FRAC_BITS   8
+#define PERIOD_MAX  0xfff // 12-bit tone period
+
+#define CHAN_IDX(chan) ((uint8_t)(chan) >> 1)
+
+/************************************************************************/
+/* Typedefs                                                             */
+/************************************************************************/
+
+typedef struct voice_t {
+	int32_t  period; /**< Glide position, 24.8 fixed point       */
+	int32_t  target; /**< Period of the note, 24.8 fixed point   */
+	int32_t  step;   /**< Glide step per tick, 24.8 fixed point  */
+	int16_t  depth;  /**< Vibrato depth, 8.8 fixed point         */
+	uint16_t out;    /**< Period in the registers                */
+	bool     active;
+	bool     played; /**< The channel played a note, glide from it */
+} voice_t;
+
+/************************************************************************/
+/* Private function declarations                                        */
+/************************************************************************/
+
+static int8_t lfo(void);
+
+/************************************************************************/
+/* Private variables                                                    */
+/************************************************************************/
+
+static const ay38910a_t * psg      = NULL;
+static sched_task_t *     mod_task = NULL;
+
+static voice_t     voices[CHANNEL_NUM];
+static uint8_t     n_active    = 0;
+static uint8_t     glide_ticks = MOD_GLIDE_MS / MOD_TICK_MS;
+static uint8_t     vib_depth   = MOD_VIB_DEPTH;
+static uint16_t    phase_inc   = (uint16_t)(MOD_VIB_HZ * 65536UL / TICK_HZ);
+static uint16_t    phase       = 0;
+static mod_stats_t stats       = {0};
+
+/************************************************************************/
+/* Function implementations                                             */
+/************************************************************************/
+
+void mod_init(const ay38910a_t * ay, sched_task_t * task) {
+	psg      = ay;
+	mod_task = task;
+	mod_task->period_ms = MOD_IDLE_MS;
+}
+
+void mod_configure(uint16_t glide_ms, uint8_t vib_hz, uint8_t depth) {
+	uint16_t ticks = glide_ms / MOD_TICK_MS;
+	glide_ticks = ticks > UINT8_MAX ? UINT8_MAX : ticks;
+	vib_depth   = depth > MOD_VIB_DEPTH_MAX ? MOD_VIB_DEPTH_MAX : depth;
+	phase_inc   = (uint16_t)(vib_hz * 65536UL / TICK_HZ);
+}
+
+void mod_note_on(channel_t chan, uint8_t note) {
+	voice_t * v      = &voices[CHAN_IDX(chan)];
+	uint16_t  period = ay38910_note_period(note);
+
+	v->target = (int32_t)period << FRAC_BITS;
+	v->depth  = (int16_t)((uint32_t)period * vib_depth * 256 / 1000);
+	if(glide_ticks > 0 && v->played && v->period != v->target) {
+		v->step = (v->target - v->period) / glide_ticks;
+		if(v->step == 0) {
+			v->step = v->target > v->period ? 1 : -1;
+		}
+		v->out = v->period >> FRAC_BITS;
+		ay38910_write_reg(psg, (uint8_t)chan, v->out & 0xff);
+		ay38910_write_reg(psg, (uint8_t)chan + 1, v->out >> 8);
+	} else {
+		v->period = v->target;
+		v->step   = 0;
+		v->out    = period;
+		ay38910_play_note(psg, chan, note);
+	}
+	v->played = true;
+
+	if(!v->active) {
+		v->active = true;
+		if(n_active++ == 0) {
+			mod_task->period_ms = MOD_TICK_MS;
+			sched_wake(mod_task);
+		}
+	}
+}
+
+void mod_note_off(channel_t chan) {
+	voice_t * v = &voices[CHAN_IDX(chan)];
+	if(!v->active) {
+		return;
+	}
+	v->active = false;
+	if(--n_active == 0) {
+		mod_task->period_ms = MOD_IDLE_MS;
+	}
+}
+
+void mod_reset(void) {
+	for(uint8_t i = 0; i < CHANNEL_NUM; i++) {
+		voices[i].active = false;
+		voices[i].played = false;
+	}
+	n_active = 0;
+	phase    = 0;
+	mod_task->period_ms = MOD_IDLE_MS;
+}
+
+void mod_tick(void) {
+	if(n_active == 0) {
+		return;
+	}
+
+	uint32_t start = clock_micros();
+	phase += phase_inc;
+	int8_t tri = lfo();
+
+	for(uint8_t i = 0; i < CHANNEL_NUM; i++) {
+		voice_t * v = &voices[i];
+		if(!v->active || drums_borrowed(i << 1)) {
+			continue;
+		}
+		if(v->step != 0) {
+			v->period += v->step;
+			if((v->step > 0 && v->period >= v->target) ||
+			   (v->step < 0 && v->period <= v->target)) {
+				v->period = v->target;
+				v->step   = 0;
+			}
+		}
+
+		int32_t p = (v->period + (((int32_t)v->depth * tri) >> 7)) >> FRAC_BITS;
+		if(p < 0) {
+			p = 0;
+		} else if(p > PERIOD_MAX) {
+			p = PERIOD_MAX;
+		}
+		uint16_t out = (uint16_t)p;
+		uint16_t chg = out ^ v->out;
+		if(chg & 0x00ff) {
+			ay38910_write_reg(psg, i << 1, out & 0xff);
+			stats.writes++;
+		}
+		if(chg & 0xff00) {
+			ay38910_write_reg(psg, (i << 1) + 1, out >> 8);
+			stats.writes++;
+		}
+		v->out = out;
+	}
+
+	uint32_t us = clock_micros() - start;
+	stats.ticks++;
+	stats.chan_ticks += n_active;
+	stats.total_us   += us;
+	if(us > stats.max_us) {
+		stats.max_us = us;
+	}
+}
+
+void mod_stats(mod_stats_t * st) {
+	*st = stats;
+}
+
+/************************************************************************/
+/* Private Helpers                                                      */
+/************************************************************************/
+
+/**
+ * Triangle LFO, from the upper byte of the phase.
+ * @return -128 to 126
+ */
+static int8_t lfo(void) {
+	uint8_t p = phase >> 8;
+	return (int8_t)(p < 128 ? p * 2 - 128 : 382 - p * 2);
+}
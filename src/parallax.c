@@ -1,158 +1,106 @@
-#include "ay38910a.h"
-#include "delay.h"
+#include "song.h"
+
+#include <stddef.h>
+#include <avr/pgmspace.h>
+
+/**
+ * Parallax theme, one note per event on channel A, 50 ms per tick.
+ * Phrases that repeat are stored once as patterns: the intro is built
+ * from a 4-note cell on C and one on D, the verse from 6-note cells
+ * alternating a high and a low note, each played twice.
+ */
+
+#define N(n, oct)   SONG_NOTE(NOTE(n, oct))
+#define T(ms)       SONG_WAIT((ms) / 50)
+
+#define VERSE_CELL(hi, hi_oct, lo, lo_oct) {         \
+	N(hi, hi_oct), T(300), N(lo, lo_oct), T(500),    \
+	N(hi, hi_oct), T(300), N(lo, lo_oct), T(500),    \
+	N(hi, hi_oct), T(250), N(lo, lo_oct), T(250),    \
+	SONG_END                                         \
+}
 
-#define SIZE(x) ((uint8_t)(sizeof(x)/sizeof(x[0])))
+static const uint8_t intro_c[] PROGMEM = {
+	SONG_VOL(MAX_AMPL),
+	N(C_NOTE, 2), T(500), N(F_SHARP_NOTE, 2), T(250),
+	N(A_SHARP_NOTE, 2), T(550), N(F_SHARP_NOTE, 2), T(500),
+	SONG_END
+};
 
-struct note {
-	int note;
-	int duration;
+static const uint8_t intro_c_end1[] PROGMEM = {
+	N(C_NOTE, 2), T(250), N(F_SHARP_NOTE, 2), T(250),
+	SONG_END
 };
 
-const struct note parallax[] = {
-	{NOTE(C_NOTE, 2), 500},
-	{NOTE(F_SHARP_NOTE, 2), 250},
-	{NOTE(A_SHARP_NOTE, 2), 550},
-	{NOTE(F_SHARP_NOTE, 2), 500},
-	{NOTE(C_NOTE, 2), 500},
-	{NOTE(F_SHARP_NOTE, 2), 250},
-	{NOTE(A_SHARP_NOTE, 2), 550},
-	{NOTE(F_SHARP_NOTE, 2), 500},
-	{NOTE(C_NOTE, 2), 250},
-	{NOTE(F_SHARP_NOTE, 2), 250},
-
-	{NOTE(C_NOTE, 2), 500},
-	{NOTE(F_SHARP_NOTE, 2), 250},
-	{NOTE(A_SHARP_NOTE, 2), 550},
-	{NOTE(F_SHARP_NOTE, 2), 500},
-	{NOTE(C_NOTE, 2), 500},
-	{NOTE(F_SHARP_NOTE, 2), 250},
-	{NOTE(A_SHARP_NOTE, 2), 550},
-	{NOTE(F_SHARP_NOTE, 2), 500},
-	{NOTE(C_NOTE, 2), 250},
-	{NOTE(C_SHARP_NOTE, 2), 250},
-
-	{NOTE(D_NOTE, 2), 500},
-	{NOTE(F_SHARP_NOTE, 2), 250},
-	{NOTE(A_SHARP_NOTE, 2), 550},
-	{NOTE(F_SHARP_NOTE, 2), 500},
-	{NOTE(D_NOTE, 2), 500},
-	{NOTE(F_SHARP_NOTE, 2), 250},
-	{NOTE(A_SHARP_NOTE, 2), 550},
-	{NOTE(F_SHARP_NOTE, 2), 500},
-	{NOTE(D_NOTE, 2), 250},
-	{NOTE(F_SHARP_NOTE, 2), 250},
-
-	{NOTE(D_NOTE, 2), 500},
-	{NOTE(F_SHARP_NOTE, 2), 250},
-	{NOTE(A_SHARP_NOTE, 2), 550},
-	{NOTE(F_SHARP_NOTE, 2), 500},
-	{NOTE(D_NOTE, 2), 500},
-	{NOTE(F_SHARP_NOTE, 2), 250},
-	{NOTE(A_SHARP_NOTE, 2), 250},
-	{NOTE(D_NOTE, 2), 250},
-	{NOTE(D_SHARP_NOTE, 2), 250},
-	{NOTE(D_NOTE, 2), 250},
-	{NOTE(C_NOTE, 2), 250},
-	{NOTE(D_NOTE, 2), 250},
+static const uint8_t intro_c_end2[] PROGMEM = {
+	N(C_NOTE, 2), T(250), N(C_SHARP_NOTE, 2), T(250),
+	SONG_END
 };
 
-const struct note verse[] = {
-	{NOTE(G_NOTE, 3), 300},
-	{NOTE(C_NOTE, 3), 500},
-	{NOTE(G_NOTE, 3), 300},
-	{NOTE(C_NOTE, 3), 500},
-	{NOTE(G_NOTE, 3), 250},
-	{NOTE(C_NOTE, 3), 250},
-	{NOTE(G_NOTE, 3), 300},
-	{NOTE(C_NOTE, 3), 500},
-	{NOTE(G_NOTE, 3), 300},
-	{NOTE(C_NOTE, 3), 500},
-	{NOTE(G_NOTE, 3), 250},
-	{NOTE(C_NOTE, 3), 250},
-
-	{NOTE(F_SHARP_NOTE, 3), 300},
-	{NOTE(C_NOTE, 3), 500},
-	{NOTE(F_SHARP_NOTE, 3), 300},
-	{NOTE(C_NOTE, 3), 500},
-	{NOTE(F_SHARP_NOTE, 3), 250},
-	{NOTE(C_NOTE, 3), 250},
-	{NOTE(F_SHARP_NOTE, 3), 300},
-	{NOTE(C_NOTE, 3), 500},
-	{NOTE(F_SHARP_NOTE, 3), 300},
-	{NOTE(C_NOTE, 3), 500},
-	{NOTE(F_SHARP_NOTE, 3), 250},
-	{NOTE(C_NOTE, 3), 250},
-
-	{NOTE(F_NOTE, 3), 300},
-	{NOTE(G_NOTE, 2), 500},
-	{NOTE(F_NOTE, 3), 300},
-	{NOTE(G_NOTE, 2), 500},
-	{NOTE(F_NOTE, 3), 250},
-	{NOTE(G_NOTE, 2), 250},
-	{NOTE(F_NOTE, 3), 300},
-	{NOTE(G_NOTE, 2), 500},
-	{NOTE(F_NOTE, 3), 300},
-	{NOTE(G_NOTE, 2), 500},
-	{NOTE(F_NOTE, 3), 250},
-	{NOTE(G_NOTE, 2), 250},
-
-	{NOTE(D_SHARP_NOTE, 3), 300},
-	{NOTE(F_SHARP_NOTE, 2), 500},
-	{NOTE(D_SHARP_NOTE, 3), 300},
-	{NOTE(F_SHARP_NOTE, 2), 500},
-	{NOTE(D_SHARP_NOTE, 3), 250},
-	{NOTE(F_SHARP_NOTE, 2), 250},
-	{NOTE(D_SHARP_NOTE, 3), 300},
-	{NOTE(F_SHARP_NOTE, 2), 500},
-	{NOTE(D_SHARP_NOTE, 3), 300},
-	{NOTE(F_SHARP_NOTE, 2), 500},
-	{NOTE(D_SHARP_NOTE, 3), 250},
-	{NOTE(F_SHARP_NOTE, 2), 250},
-
-	{NOTE(G_NOTE, 2), 300},
-	{NOTE(C_NOTE, 2), 500},
-	{NOTE(G_NOTE, 2), 300},
-	{NOTE(C_NOTE, 2), 500},
-	{NOTE(G_NOTE, 2), 250},
-	{NOTE(C_NOTE, 2), 250},
-	{NOTE(G_NOTE, 2), 300},
-	{NOTE(C_NOTE, 2), 500},
-	{NOTE(G_NOTE, 2), 300},
-	{NOTE(C_NOTE, 2), 500},
-	{NOTE(G_NOTE, 2), 250},
-	{NOTE(C_NOTE, 2), 250},
-
-	{NOTE(F_SHARP_NOTE, 2), 300},
-	{NOTE(C_NOTE, 2), 500},
-	{NOTE(F_SHARP_NOTE, 2), 300},
-	{NOTE(C_NOTE, 2), 500},
-	{NOTE(F_SHARP_NOTE, 2), 250},
-	{NOTE(C_NOTE, 2), 250},
-	{NOTE(F_SHARP_NOTE, 2), 300},
-	{NOTE(C_NOTE, 2), 500},
-	{NOTE(F_SHARP_NOTE, 2), 300},
-	{NOTE(C_NOTE, 2), 500},
- 	{NOTE(F_SHARP_NOTE, 2), 250},
-	{NOTE(C_NOTE, 2), 250},
+static const uint8_t intro_d[] PROGMEM = {
+	N(D_NOTE, 2), T(500), N(F_SHARP_NOTE, 2), T(250),
+	N(A_SHARP_NOTE, 2), T(550), N(F_SHARP_NOTE, 2), T(500),
+	SONG_END
 };
 
+static const uint8_t intro_d_end1[] PROGMEM = {
+	N(D_NOTE, 2), T(250), N(F_SHARP_NOTE, 2), T(250),
+	SONG_END
+};
 
-void play_parallax(const ay38910a_t * ay, const timer_t * timer) {
-	ay38910_init(ay, timer);
-	ay38910_channel_mode(ay, CHAN_ENABLE(CHA_TONE));
-
-	while(1) {
-		ay38910_set_amplitude(ay, CHANNEL_A, MAX_AMPL & AMPL_ENV_DISABLE);
-		for(uint8_t i = 0; i < SIZE(parallax); i++) {
-			ay38910_play_note(ay, CHANNEL_A, parallax[i].note);
-			delay_ms(parallax[i].duration);
-		}
-
-		ay38910_set_amplitude(ay, CHANNEL_A, MAX_AMPL | AMPL_ENV_ENABLE);
-		ay38910_set_envelope(ay, FUNC_ATTACK | FUNC_CONTINUE, 1000);
-		for(uint8_t j = 0; j < SIZE(verse); j++) {
-			ay38910_play_note(ay, CHANNEL_A, verse[j].note);
-			delay_ms(verse[j].duration);
-		}
-	}
-}
+static const uint8_t intro_d_end2[] PROGMEM = {
+	N(D_NOTE, 2), T(500), N(F_SHARP_NOTE, 2), T(250),
+	N(A_SHARP_NOTE, 2), T(250), N(D_NOTE, 2), T(250),
+	N(D_SHARP_NOTE, 2), T(250), N(D_NOTE, 2), T(250),
+	N(C_NOTE, 2), T(250), N(D_NOTE, 2), T(250),
+	SONG_END
+};
+
+static const uint8_t verse_env[] PROGMEM = {SONG_ENV, SONG_END};
+
+static const uint8_t verse_g3[] PROGMEM  = VERSE_CELL(G_NOTE, 3, C_NOTE, 3);
+static const uint8_t verse_fs3[] PROGMEM = VERSE_CELL(F_SHARP_NOTE, 3, C_NOTE, 3);
+static const uint8_t verse_f3[] PROGMEM  = VERSE_CELL(F_NOTE, 3, G_NOTE, 2);
+static const uint8_t verse_ds3[] PROGMEM = VERSE_CELL(D_SHARP_NOTE, 3, F_SHARP_NOTE, 2);
+static const uint8_t verse_g2[] PROGMEM  = VERSE_CELL(G_NOTE, 2, C_NOTE, 2);
+static const uint8_t verse_fs2[] PROGMEM = VERSE_CELL(F_SHARP_NOTE, 2, C_NOTE, 2);
+
+enum {
+	INTRO_C, INTRO_C_END1, INTRO_C_END2, INTRO_D, INTRO_D_END1, INTRO_D_END2,
+	VERSE_ENV, VERSE_G3, VERSE_FS3, VERSE_F3, VERSE_DS3, VERSE_G2, VERSE_FS2,
+};
+
+static const uint8_t * const patterns[] PROGMEM = {
+	[INTRO_C]      = intro_c,
+	[INTRO_C_END1] = intro_c_end1,
+	[INTRO_C_END2] = intro_c_end2,
+	[INTRO_D]      = intro_d,
+	[INTRO_D_END1] = intro_d_end1,
+	[INTRO_D_END2] = intro_d_end2,
+	[VERSE_ENV]    = verse_env,
+	[VERSE_G3]     = verse_g3,
+	[VERSE_FS3]    = verse_fs3,
+	[VERSE_F3]     = verse_f3,
+	[VERSE_DS3]    = verse_ds3,
+	[VERSE_G2]     = verse_g2,
+	[VERSE_FS2]    = verse_fs2,
+};
+
+static const uint8_t order_a[] PROGMEM = {
+	INTRO_C, INTRO_C, INTRO_C_END1,
+	INTRO_C, INTRO_C, INTRO_C_END2,
+	INTRO_D, INTRO_D, INTRO_D_END1,
+	INTRO_D, INTRO_D_END2,
+	VERSE_ENV,
+	VERSE_G3, VERSE_G3, VERSE_FS3, VERSE_FS3, VERSE_F3, VERSE_F3,
+	VERSE_DS3, VERSE_DS3, VERSE_G2, VERSE_G2, VERSE_FS2, VERSE_FS2,
+	SONG_LOOP
+};
+
+const song_t song_parallax PROGMEM = {
+	.tick_ms    = 50,
+	.env_shape  = FUNC_ATTACK | FUNC_CONTINUE,
+	.env_period = 1000,
+	.patterns   = patterns,
+	.orders     = {order_a, NULL, NULL},
+};
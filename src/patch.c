@@ -0,0 +1,139 @@
+/************************************************************************/
+/* Includes                                                             */
+/************************************************************************/
+
+#include "patch.h"
+#include "clock.h"
+#include "drums.h"
+#include "mod.h"
+
+#include <stddef.h>
+#include <util/atomic.h>
+#include <avr/pgmspace.h>
+
+/************************************************************************/
+/* Defines                                                              */
+/************************************************************************/
+
+#define SIZE(x)    ((uint8_t)(sizeof(x)/sizeof(x[0])))
+#define NOISE_BITS (CHAN_DISABLE(CHA_NOISE) | CHAN_DISABLE(CHB_NOISE) | \
+                    CHAN_DISABLE(CHC_NOISE))
+
+/************************************************************************/
+/* Private function declarations                                        */
+/************************************************************************/
+
+static bool uses_envelope(const patch_t * p);
+
+/************************************************************************/
+/* Private variables                                                    */
+/************************************************************************/
+
+// Write order of a delta: the amplitudes last, once the sources are set
+static const uint8_t burst_order[] PROGMEM = {
+	AY38910A_REG_NOISE,
+	AY38910A_REG_MIXER,
+	AY38910A_REG_ENV_FINE,
+	AY38910A_REG_ENV_CRS,
+	AY38910A_REG_ENV_SHP,
+	AY38910A_REG_AMP_A,
+	AY38910A_REG_AMP_A + 1,
+	AY38910A_REG_AMP_A + 2,
+};
+
+static const ay38910a_t * psg     = NULL;
+static uint8_t *          mix     = NULL;
+static patch_t            current = {0};
+static patch_stats_t      stats   = {0};
+
+/************************************************************************/
+/* Function implementations                                             */
+/************************************************************************/
+
+void patch_init(const ay38910a_t * ay, uint8_t * mixer) {
+	psg = ay;
+	mix = mixer;
+}
+
+uint8_t patch_apply(const patch_t * patch) {
+	uint8_t img[AY38910A_REGS];
+	for(uint8_t r = 0; r < AY38910A_REGS; r++) {
+		img[r] = ay38910_read_shadow(psg, r);
+	}
+
+	// The tone bits belong to the notes, the patch only sets the noise ones
+	uint8_t m = *mix | NOISE_BITS;
+	for(uint8_t i = 0; i < CHANNEL_NUM; i++) {
+		if(patch->voices[i].noise) {
+			m &= CHAN_ENABLE((i + CHA_NOISE));
+		}
+		// Silent voices keep their 0 amplitude until their next note, the
+		// playing ones only change level with the patch
+		if(!(*mix & CHAN_DISABLE(i)) && !drums_borrowed(i << 1) &&
+		   patch->voices[i].amp != current.voices[i].amp) {
+			img[AY38910A_REG_AMP_A + i] = patch->voices[i].amp & 0x1f;
+		}
+	}
+	*mix = m;
+	img[AY38910A_REG_NOISE] = patch->noise & 0x1f;
+	img[AY38910A_REG_MIXER] = (img[AY38910A_REG_MIXER] & ~0x3f) | (m & 0x3f);
+
+	if(uses_envelope(patch)) {
+		if(!patch->buzzer) {
+			img[AY38910A_REG_ENV_FINE] = patch->env_period & 0xff;
+			img[AY38910A_REG_ENV_CRS]  = patch->env_period >> 8;
+		}
+		img[AY38910A_REG_ENV_SHP] = patch->env_shape & 0x0f;
+	}
+
+	uint8_t  n = 0;
+	uint32_t start = clock_micros();
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		for(uint8_t i = 0; i < SIZE(burst_order); i++) {
+			uint8_t r = pgm_read_byte(&burst_order[i]);
+			if(img[r] != ay38910_read_shadow(psg, r)) {
+				ay38910_write_reg(psg, r, img[r]);
+				n++;
+			}
+		}
+	}
+	uint32_t us = clock_micros() - start;
+
+	if(patch->glide_ms != current.glide_ms || patch->vib_hz != current.vib_hz ||
+	   patch->vib_depth != current.vib_depth) {
+		mod_configure(patch->glide_ms, patch->vib_hz, patch->vib_depth);
+	}
+	current = *patch;
+
+	stats.applies++;
+	stats.writes += n;
+	if(us > stats.max_us) {
+		stats.max_us = us;
+	}
+	return n;
+}
+
+const patch_t * patch_current(void) {
+	return &current;
+}
+
+uint8_t patch_amp(channel_t chan) {
+	return current.voices[(uint8_t)chan >> 1].amp;
+}
+
+void patch_stats(patch_stats_t * st) {
+	*st = stats;
+}
+
+/************************************************************************/
+/* Private Helpers                                                      */
+/************************************************************************/
+
+static bool uses_envelope(const patch_t * p) {
+	for(uint8_t i = 0; i < CHANNEL_NUM; i++) {
+		if(p->voices[i].amp & AMPL_ENV_ENABLE) {
+			return true;
+		}
+	}
+	return false;
+}
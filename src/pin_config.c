@@ -128,3 +128,13 @@ uint8_t read_debounced(pin_t p) {
 	} while(acc != 0x00 && acc != 0xff);
 	return acc;
 }
+
+uint8_t debounce_pin(debounce_t * d, pin_t p) {
+	d->samples = (d->samples << 1) | read_pin(p.port, p.pin);
+	if(d->samples == 0x00) {
+		d->level = 0;
+	} else if(d->samples == 0xff) {
+		d->level = 1;
+	}
+	return d->level;
+}
@@ -0,0 +1,182 @@
+/************************************************************************/
+/* Includes                                                             */
+/************************************************************************/
+
+#include "presets.h"
+
+#include <avr/interrupt.h>
+#include <avr/eeprom.h>
+#include <util/atomic.h>
+#include <util/crc16.h>
+#include <avr/io.h>
+
+/************************************************************************/
+/* Defines                                                              */
+/************************************************************************/
+
+#define RECORD_SIZE  (sizeof(preset_record_t))
+#define SEQ_NEWER(a, b) ((int8_t)((uint8_t)(a) - (uint8_t)(b)) > 0)
+
+/************************************************************************/
+/* Typedefs                                                             */
+/************************************************************************/
+
+/**
+ * EEPROM record layout. The sequence number is written last, so that a
+ * torn write never produces a record that looks newer than the ones
+ * that are already in the ring.
+ */
+typedef struct {
+	settings_t stg;
+	uint8_t    crc;
+	uint8_t    seq;
+} preset_record_t;
+
+typedef struct {
+	settings_t stg;
+	uint8_t    seq;   // sequence number of the newest record
+	uint8_t    head;  // ring index of the newest record
+	bool       valid;
+} preset_slot_t;
+
+/************************************************************************/
+/* Private function declarations                                        */
+/************************************************************************/
+
+static uint8_t record_crc(const preset_record_t * rec);
+static bool start_next_write(void);
+
+/************************************************************************/
+/* Private variables                                                    */
+/************************************************************************/
+
+static preset_record_t EEMEM ring[PRESET_SLOTS][PRESET_RING_LEN];
+
+static preset_slot_t bank[PRESET_SLOTS];
+
+static volatile uint8_t dirty = 0; // bitmask of slots to write back
+
+// Write-back state, only touched by the EE_READY interrupt
+static preset_record_t wr_rec;
+static uint16_t        wr_addr;
+static uint8_t         wr_idx = RECORD_SIZE;
+
+/************************************************************************/
+/* Function implementations                                             */
+/************************************************************************/
+
+void preset_init(void) {
+	preset_record_t rec;
+
+	eeprom_busy_wait();
+	for(uint8_t s = 0; s < PRESET_SLOTS; s++) {
+		preset_slot_t * slot = &bank[s];
+		slot->valid = false;
+		slot->head  = PRESET_RING_LEN - 1;
+		slot->seq   = 0;
+
+		for(uint8_t i = 0; i < PRESET_RING_LEN; i++) {
+			eeprom_read_block(&rec, &ring[s][i], RECORD_SIZE);
+			if(rec.crc != record_crc(&rec)) {
+				continue;
+			}
+			if(!slot->valid || SEQ_NEWER(rec.seq, slot->seq)) {
+				slot->stg   = rec.stg;
+				slot->seq   = rec.seq;
+				slot->head  = i;
+				slot->valid = true;
+			}
+		}
+	}
+}
+
+bool preset_load(uint8_t slot, settings_t * s) {
+	if(slot >= PRESET_SLOTS || !bank[slot].valid) {
+		return false;
+	}
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		*s = bank[slot].stg;
+	}
+	return true;
+}
+
+void preset_save(uint8_t slot, const settings_t * s) {
+	if(slot >= PRESET_SLOTS) {
+		return;
+	}
+	preset_slot_t * dst = &bank[slot];
+	if(dst->valid && dst->stg.amplitude == s->amplitude &&
+	   dst->stg.octave == s->octave && dst->stg.env_shape == s->env_shape) {
+		return; // nothing changed, spare the EEPROM a write cycle
+	}
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		dst->stg   = *s;
+		dst->valid = true;
+		dirty |= (1 << slot);
+		EECR  |= (1 << EERIE);
+	}
+}
+
+bool preset_busy(void) {
+	return dirty != 0 || (EECR & (1 << EERIE));
+}
+
+/************************************************************************/
+/* Private Helpers                                                      */
+/************************************************************************/
+
+/**
+ * Computes the CRC8 of a record, sequence number included.
+ */
+static uint8_t record_crc(const preset_record_t * rec) {
+	uint8_t crc = 0xff;
+	crc = _crc8_ccitt_update(crc, rec->stg.amplitude);
+	crc = _crc8_ccitt_update(crc, rec->stg.octave);
+	crc = _crc8_ccitt_update(crc, rec->stg.env_shape);
+	crc = _crc8_ccitt_update(crc, rec->stg.arp_rate);
+	crc = _crc8_ccitt_update(crc, rec->seq);
+	return crc;
+}
+
+/**
+ * Picks the lowest dirty slot and prepares its next record for the
+ * write-back, advancing the slot ring. Called from the EE_READY ISR.
+ * @return false if there is nothing left to write
+ */
+static bool start_next_write(void) {
+	if(dirty == 0) {
+		return false;
+	}
+
+	uint8_t s = 0;
+	while(!(dirty & (1 << s))) {
+		s++;
+	}
+	dirty &= ~(1 << s);
+
+	preset_slot_t * slot = &bank[s];
+	slot->head = (slot->head + 1) % PRESET_RING_LEN;
+	slot->seq++;
+
+	wr_rec.stg = slot->stg;
+	wr_rec.seq = slot->seq;
+	wr_rec.crc = record_crc(&wr_rec);
+	wr_addr    = (uint16_t)&ring[s][slot->head];
+	wr_idx     = 0;
+	return true;
+}
+
+ISR(EE_READY_vect,) {
+	if(wr_idx >= RECORD_SIZE && !start_next_write()) {
+		EECR &= ~(1 << EERIE);
+		return;
+	}
+
+	EEAR = wr_addr + wr_idx;
+	EEDR = ((const uint8_t *)&wr_rec)[wr_idx];
+	wr_idx++;
+
+	// EEPE must be set within four cycles from EEMPE
+	EECR |= (1 << EEMPE);
+	EECR |= (1 << EEPE);
+}
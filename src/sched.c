@@ -0,0 +1,183 @@
+/************************************************************************/
+/* Includes                                                             */
+/************************************************************************/
+
+#include "sched.h"
+#include "clock.h"
+
+#include <assert.h>
+#include <stddef.h>
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+#include <util/atomic.h>
+
+/************************************************************************/
+/* Defines                                                              */
+/************************************************************************/
+
+/** Wrap-safe a < b on the millisecond clock */
+#define BEFORE(a, b) ((int32_t)((a) - (b)) < 0)
+
+/************************************************************************/
+/* Private function declarations                                        */
+/************************************************************************/
+
+static void idle(void);
+
+/************************************************************************/
+/* Private variables                                                    */
+/************************************************************************/
+
+static sched_task_t * tasks[SCHED_MAX_TASKS];
+static uint8_t        n_tasks  = 0;
+static sched_task_t * running  = NULL;
+static bool           sleeping = false;
+static uint16_t       sleep_ms = 0;
+
+static volatile bool  wake_pending = false;
+static sched_idle_t   idle_stats   = {0};
+static uint32_t       start_us     = 0;
+
+/************************************************************************/
+/* Function implementations                                             */
+/************************************************************************/
+
+void sched_add(sched_task_t * task) {
+	assert(n_tasks < SCHED_MAX_TASKS);
+	task->release = clock_millis();
+	task->woken   = false;
+	task->stats   = (sched_stats_t){0};
+	if(n_tasks == 0) {
+		start_us = clock_micros();
+	}
+	tasks[n_tasks++] = task;
+}
+
+bool sched_run_once(void) {
+	wake_pending = false;
+	uint32_t       now  = clock_millis();
+	sched_task_t * next = NULL;
+	uint32_t       next_deadline = 0;
+
+	for(uint8_t i = 0; i < n_tasks; i++) {
+		sched_task_t * t = tasks[i];
+		// A woken task is released now, whatever its release time
+		uint32_t release = t->woken ? now : t->release;
+		if(BEFORE(now, release)) {
+			continue;
+		}
+		uint32_t deadline = release + t->period_ms;
+		if(next == NULL || BEFORE(deadline, next_deadline)) {
+			next          = t;
+			next_deadline = deadline;
+		}
+	}
+	if(next == NULL) {
+		return false;
+	}
+
+	// Latency is measured from the wake, or from the release time
+	uint32_t start = clock_micros();
+	uint32_t from  = next->release * 1000;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		if(next->woken) {
+			next->woken   = false;
+			next->release = now;
+			from          = next->wake_us;
+		}
+	}
+	uint32_t latency = (int32_t)(start - from) > 0 ? start - from : 0;
+
+	running  = next;
+	sleeping = false;
+	next->run();
+	uint32_t us  = clock_micros() - start;
+	uint32_t end = clock_millis();
+	running  = NULL;
+
+	sched_stats_t * st = &next->stats;
+	st->runs++;
+	st->total_us += us;
+	if(us > st->max_us) {
+		st->max_us = us > UINT16_MAX ? UINT16_MAX : us;
+	}
+	if(latency > st->max_latency_us) {
+		st->max_latency_us = latency > UINT16_MAX ? UINT16_MAX : latency;
+	}
+
+	// The miss is judged in us: in ms a 1 ms task would miss every time
+	// its run straddles a tick
+	uint32_t deadline_us = from + (uint32_t)next->period_ms * 1000;
+	if((int32_t)(start + us - deadline_us) > 0) {
+		st->missed++;
+	}
+
+	uint32_t deadline = next->release + next->period_ms;
+	if(sleeping) {
+		next->release = end + sleep_ms;
+	} else {
+		next->release = BEFORE(end, deadline) ? deadline : end;
+	}
+	return true;
+}
+
+void sched_run(void) {
+	for(;;) {
+		if(!sched_run_once()) {
+			idle();
+		}
+	}
+}
+
+void sched_sleep(uint16_t ms) {
+	if(running != NULL) {
+		sleeping = true;
+		sleep_ms = ms;
+	}
+}
+
+void sched_wake(sched_task_t * task) {
+	task->wake_us = clock_micros();
+	task->woken   = true;
+	wake_pending  = true;
+}
+
+void sched_idle(sched_idle_t * st) {
+	*st = idle_stats;
+	st->total_us = clock_micros() - start_us;
+}
+
+uint8_t sched_tasks(void) {
+	return n_tasks;
+}
+
+const sched_task_t * sched_task(uint8_t i) {
+	return tasks[i];
+}
+
+/************************************************************************/
+/* Private Helpers                                                      */
+/************************************************************************/
+
+/**
+ * Sleeps until the next interrupt. Interrupts are masked while checking
+ * for a pending wake: SEI only takes effect after the next instruction,
+ * so a wake posted right before SLEEP still ends the sleep at once.
+ */
+static void idle(void) {
+	uint32_t from = clock_micros();
+
+	set_sleep_mode(SLEEP_MODE_IDLE);
+	cli();
+	if(wake_pending) {
+		sei();
+		return;
+	}
+	sleep_enable();
+	sei();
+	sleep_cpu();
+	sleep_disable();
+
+	idle_stats.sleeps++;
+	idle_stats.idle_us += clock_micros() - from;
+}
@@ -0,0 +1,213 @@
+/************************************************************************/
+/* Includes                                                             */
+/************************************************************************/
+
+#include "seq.h"
+#include "drums.h"
+
+#include <stddef.h>
+#include <avr/pgmspace.h>
+
+/************************************************************************/
+/* Defines                                                              */
+/************************************************************************/
+
+#define IS_NOTE(ev)  ((ev) <= SONG_NOTE_MAX)
+#define IS_WAIT(ev)  (((ev) & 0xc0) == 0x80)
+#define IS_VOL(ev)   (((ev) & 0xf0) == 0xc0)
+#define WAIT_OF(ev)  (((ev) & 0x3f) + 1)
+
+/************************************************************************/
+/* Typedefs                                                             */
+/************************************************************************/
+
+typedef struct track_t {
+	const uint8_t * order; /**< Next order list entry, in flash */
+	const uint8_t * pos;   /**< Next event, in flash            */
+	uint16_t        wait;  /**< Ticks left before the next event */
+	uint8_t         amp;   /**< Amplitude register of the notes */
+	bool            active;
+} track_t;
+
+/************************************************************************/
+/* Private function declarations                                        */
+/************************************************************************/
+
+static bool next_pattern(track_t * t, uint8_t ch);
+static uint8_t run_events(track_t * t, uint8_t ch);
+static void silence(uint8_t ch);
+
+/************************************************************************/
+/* Private variables                                                    */
+/************************************************************************/
+
+static const ay38910a_t * psg      = NULL;
+static uint8_t *          mix      = NULL;
+static sched_task_t *     seq_task = NULL;
+
+static song_t      song;   // SRAM copy of the descriptor only
+static track_t     tracks[CHANNEL_NUM];
+static bool        playing = false;
+static seq_stats_t stats   = {0};
+
+/************************************************************************/
+/* Function implementations                                             */
+/************************************************************************/
+
+void seq_init(const ay38910a_t * ay, uint8_t * mixer, sched_task_t * task) {
+	psg      = ay;
+	mix      = mixer;
+	seq_task = task;
+	seq_task->period_ms = SEQ_IDLE_MS;
+}
+
+void seq_play(const song_t * s) {
+	seq_stop();
+	memcpy_P(&song, s, sizeof(song));
+
+	for(uint8_t ch = 0; ch < CHANNEL_NUM; ch++) {
+		track_t * t = &tracks[ch];
+		t->order  = song.orders[ch];
+		t->wait   = 0;
+		t->amp    = MAX_AMPL;
+		t->active = t->order != NULL && next_pattern(t, ch);
+		if(t->active) {
+			*mix &= CHAN_ENABLE((CHA_TONE + ch));
+			playing = true;
+		}
+	}
+	ay38910_channel_mode(psg, *mix);
+
+	seq_task->period_ms = song.tick_ms;
+	sched_wake(seq_task);
+}
+
+void seq_stop(void) {
+	for(uint8_t ch = 0; ch < CHANNEL_NUM; ch++) {
+		if(tracks[ch].active) {
+			tracks[ch].active = false;
+			silence(ch);
+		}
+	}
+	playing = false;
+	seq_task->period_ms = SEQ_IDLE_MS;
+}
+
+bool seq_playing(void) {
+	return playing;
+}
+
+void seq_tick(void) {
+	if(!playing) {
+		return;
+	}
+
+	uint8_t events = 0;
+	bool    active = false;
+	for(uint8_t ch = 0; ch < CHANNEL_NUM; ch++) {
+		track_t * t = &tracks[ch];
+		if(!t->active) {
+			continue;
+		}
+		if(t->wait == 0 || --t->wait == 0) {
+			events += run_events(t, ch);
+		}
+		active |= t->active;
+	}
+
+	stats.ticks++;
+	stats.events += events;
+	if(events > stats.max_events) {
+		stats.max_events = events;
+	}
+	if(!active) {
+		seq_stop();
+	}
+}
+
+void seq_stats(seq_stats_t * st) {
+	*st = stats;
+}
+
+/************************************************************************/
+/* Private Helpers                                                      */
+/************************************************************************/
+
+/**
+ * Moves a track to the next pattern of its order list.
+ * @return false if the order list is over
+ */
+static bool next_pattern(track_t * t, uint8_t ch) {
+	for(;;) {
+		uint8_t idx = pgm_read_byte(t->order);
+		if(idx == SONG_STOP) {
+			return false;
+		}
+		if(idx == SONG_LOOP) {
+			// An order list made of a loop only would spin forever
+			if(t->order == song.orders[ch]) {
+				return false;
+			}
+			t->order = song.orders[ch];
+			continue;
+		}
+		t->order++;
+		t->pos = (const uint8_t *)pgm_read_word(&song.patterns[idx]);
+		return true;
+	}
+}
+
+/**
+ * Runs the events of a track up to the next wait, or SEQ_MAX_EVENTS.
+ * @return the number of events read
+ */
+static uint8_t run_events(track_t * t, uint8_t ch) {
+	channel_t chan = (channel_t)(ch << 1);
+	uint8_t   n    = 0;
+
+	while(t->wait == 0 && t->active) {
+		if(n == SEQ_MAX_EVENTS) {
+			// Wait stays 0, the track carries on at the next tick
+			stats.deferred++;
+			break;
+		}
+		uint8_t ev = pgm_read_byte(t->pos++);
+		n++;
+
+		if(IS_NOTE(ev)) {
+			if(!drums_defer(chan, ay38910_note_period(ev), t->amp)) {
+				ay38910_play_note(psg, chan, ev);
+				ay38910_set_amplitude(psg, chan, t->amp);
+			}
+		} else if(IS_WAIT(ev)) {
+			t->wait = WAIT_OF(ev);
+		} else if(IS_VOL(ev)) {
+			t->amp = ev & 0x0f;
+		} else if(ev == SONG_REST) {
+			if(!drums_defer(chan, 0, 0)) {
+				ay38910_set_amplitude(psg, chan, 0);
+			}
+		} else if(ev == SONG_ENV) {
+			t->amp = MAX_AMPL | AMPL_ENV_ENABLE;
+			ay38910_set_envelope(psg, song.env_shape, song.env_period);
+		} else if(ev == SONG_WAIT_LONG) {
+			t->wait = pgm_read_byte(t->pos++) + SONG_WAIT_MAX + 1;
+		} else if(ev == SONG_DRUM) {
+			drums_hit(pgm_read_byte(t->pos++));
+		} else if(ev == SONG_END) {
+			if(!next_pattern(t, ch)) {
+				t->active = false;
+				silence(ch);
+			}
+		}
+	}
+	return n;
+}
+
+static void silence(uint8_t ch) {
+	if(!drums_defer((channel_t)(ch << 1), 0, 0)) {
+		ay38910_set_amplitude(psg, (channel_t)(ch << 1), 0);
+	}
+	*mix |= CHAN_DISABLE((CHA_TONE + ch));
+	ay38910_channel_mode(psg, *mix);
+}
@@ -3,12 +3,24 @@
 /************************************************************************/
 
 #include "settings.h"
+#include "presets.h"
+#include "arp.h"
+#include "mem.h"
+#include "clock.h"
 
 #include <avr/interrupt.h>
 #include <ay38910a.h>
+#include <adc.h>
 #include <avr/io.h>
-#include <stdio.h>
 #include <usart.h>
+#include <fmt.h>
+#include <stddef.h>
+#include <avr/pgmspace.h>
+#include <util/atomic.h>
+
+#if defined(UI_SNPRINTF)
+#include <stdio.h>
+#endif
 
 /************************************************************************/
 /* Defines                                                              */
@@ -17,7 +29,6 @@
 #define LCD_BUF_SIZE (20)
 #define CHAR_CVT_ERR (10)
 #define BUF_SIZE     (3)
-#define POT_CHAN     (0)
 
 #define IS_DIGIT(n)  (n >= 0x30 && n <= 0x39)
 #define IS_HEX_HI(n) (n >= 0x41 && n <= 0x46)
@@ -26,18 +37,25 @@
 #define ADC_MAX        (255)
 #define AMPLITUDE_CARD (15)
 #define OCTAVE_CARD    (8)
-#define WAVEFORM_CARD  (6)
-#define MENU_ENTRIES   (3)
+#define WAVEFORM_CARD  (8)
+#define ARP_RATE_STEP  (5)
+#define ARP_RATE_CARD  ((ARP_RATE_MAX - ARP_RATE_MIN) / ARP_RATE_STEP)
+#define PRESET_CARD    (PRESET_SLOTS - 1)
+#define METER_CARD     (0)
+#define MEMORY_CARD    (0)
+#define MENU_ENTRIES   (7)
 
 /************************************************************************/
 /* Private function declarations                                        */
 /************************************************************************/
 
 static uint8_t u8_from_hex_char(char c);
+static void print_preset(lcd_fb_t * fb, uint8_t slot);
+static void print_arp_rate(lcd_fb_t * fb, uint8_t hz);
+static void print_meter_label(lcd_fb_t * fb);
+static void print_memory(lcd_fb_t * fb);
 static char hex_char_from_u8(uint8_t u);
-static void adc_init(void);
-static void enable_potentiometer(void);
-static void disable_potentiometer(void);
+static void receive(char byte);
 
 /************************************************************************/
 /* Private variables                                                    */
@@ -47,15 +65,44 @@ static void disable_potentiometer(void);
  * Frame format (as hex digits encoded chars)
  * | amplitude | octave   | envelope shape |
  * | frame[0]  | frame[1] | frame[2]       |
+ *
+ * Command frames start with a non-hex char, e.g. for presets, where 't'
+ * switches to one of the patches of main instead:
+ * | 'p'       | 's'/'l'/'t' | slot/patch  |
+ * | frame[0]  | frame[1] | frame[2]       |
+ *
+ * for the songs, 'p' plays a song, 'd' a register dump and 's' stops it,
+ * 'h' hits a kit piece, 'k' turns the drum keys on (1) or off (0) and 'c'
+ * switches the register capture mode (see capture.h):
+ * | 'm'       | command  | song/piece     |
+ * | frame[0]  | frame[1] | frame[2]       |
+ *
+ * for the input recorder, 'm' switches the mode (see input.h), two hex
+ * digits load the next byte of a recording instead:
+ * | 'i'       | 'm'/hi   | mode/lo        |
+ * | frame[0]  | frame[1] | frame[2]       |
+ *
+ * and for the diagnostics queries, answered with a diag report:
+ * | '?'       | section  | unused         |
+ * | frame[0]  | frame[1] | frame[2]       |
  */
 static volatile char     recv_buf[BUF_SIZE] = {0};
 static volatile uint8_t  idx                =  0;
-static volatile uint16_t pot_data           =  0;
-
-static uint16_t menu_cardinality[MENU_ENTRIES] = {
+static bool              in_menu            =  false;
+static bool              meter_shown        =  false;
+static void (*frame_hook)(void)             =  NULL;
+static void (*byte_hook)(uint8_t byte)      =  NULL;
+// Sources sending a binary stream: the text replies would corrupt it
+static uint8_t           muted              =  0;
+
+static const uint16_t menu_cardinality[MENU_ENTRIES] PROGMEM = {
 	[MENU_AMPLITUDE] = AMPLITUDE_CARD,
 	[MENU_OCTAVE]    = OCTAVE_CARD,
 	[MENU_WAVEFORM]  = WAVEFORM_CARD,
+	[MENU_ARP_RATE]  = ARP_RATE_CARD,
+	[MENU_PRESET]    = PRESET_CARD,
+	[MENU_METER]     = METER_CARD,
+	[MENU_MEMORY]    = MEMORY_CARD,
 };
 
 static const usart_t * serial = &(usart_t) {
@@ -99,31 +146,125 @@ void stg_send_frame(const settings_t * s) {
 	buf[2] = hex_char_from_u8(s->env_shape);
 	buf[3] = '\n';
 	buf[4] = '\0';
-	usart_write(serial, buf);
-	idx = 0;
-	sei();
+	if(!muted) {
+		usart_write(serial, buf);
+	}
+	stg_frame_done();
 }
 
 uint8_t stg_received_data(void) {
 	return idx == BUF_SIZE;
 }
 
-bool stg_menu_loop(const lcd1602a_t * lcd,
+char stg_frame_command(uint8_t * arg) {
+	switch(recv_buf[0]) {
+	case FRAME_PRESET:
+		*arg = u8_from_hex_char(recv_buf[2]);
+		switch(recv_buf[1]) {
+		case FRAME_PRESET_SAVE:
+		case FRAME_PRESET_LOAD:
+		case FRAME_PATCH_APPLY:
+			return recv_buf[1];
+		default:
+			return FRAME_INVALID;
+		}
+	case FRAME_QUERY:
+		*arg = (uint8_t)recv_buf[1];
+		return FRAME_QUERY;
+	case FRAME_SONG:
+		*arg = u8_from_hex_char(recv_buf[2]);
+		switch(recv_buf[1]) {
+		case 'p':
+			return FRAME_SONG_PLAY;
+		case 'd':
+			return FRAME_DUMP_PLAY;
+		case 'h':
+			return FRAME_DRUM_HIT;
+		case 'k':
+			return FRAME_DRUM_KEYS;
+		case 'c':
+			return FRAME_CAPTURE;
+		case 's':
+			return FRAME_SONG_STOP;
+		default:
+			return FRAME_INVALID;
+		}
+	case FRAME_INPUT:
+		if(recv_buf[1] == 'm') {
+			*arg = u8_from_hex_char(recv_buf[2]);
+			return FRAME_INPUT_MODE;
+		}
+		*arg = u8_from_hex_char(recv_buf[1]) << 4 |
+		       u8_from_hex_char(recv_buf[2]);
+		return FRAME_INPUT_BYTE;
+	default:
+		return FRAME_SETTINGS;
+	}
+}
+
+void stg_frame_done(void) {
+	idx = 0;
+	sei();
+}
+
+void stg_on_frame(void (*hook)(void)) {
+	frame_hook = hook;
+}
+
+void stg_on_byte(void (*hook)(uint8_t byte)) {
+	byte_hook = hook;
+}
+
+void stg_inject(uint8_t byte) {
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		receive((char)byte);
+	}
+}
+
+void stg_write(const char * str) {
+	if(!muted) {
+		usart_write(serial, str);
+	}
+}
+
+void stg_mute(uint8_t source, bool on) {
+	if(on) {
+		muted |= source;
+	} else {
+		muted &= ~source;
+	}
+}
+
+bool stg_try_put(uint8_t byte) {
+	return usart_try_write_byte(serial, byte);
+}
+
+bool stg_menu_loop(lcd_fb_t * fb,
                    const settings_ctl_t * ctl, settings_t * stg) {
 	static enum menu_state selected = MENU_AMPLITUDE;
 	static settings_t      in_stg   = {0};
-	static bool in_menu             = false;
+	static uint8_t         in_slot  = PRESET_WORKING;
+	static debounce_t      nav_db   = DEBOUNCE_RELEASED;
+	static debounce_t      sel_db   = DEBOUNCE_RELEASED;
 	static bool last_nav_pressed    = false;
 	static bool last_sel_pressed    = false;
 
-	uint8_t nav_pressed = read_debounced(ctl->nav_pin) == 0x00;
-	uint8_t sel_pressed = read_debounced(ctl->sel_pin) == 0x00;
+	// One sample per call, the caller paces the debouncing
+	uint8_t nav_pressed = debounce_pin(&nav_db, ctl->nav_pin) == 0;
+	uint8_t sel_pressed = debounce_pin(&sel_db, ctl->sel_pin) == 0;
 
 	if(sel_pressed && !last_sel_pressed) {
-		in_menu = false;
+		in_menu     = false;
+		meter_shown = false;
+		if(selected == MENU_PRESET && preset_load(in_slot, &in_stg)) {
+			stg_print_settings(fb, &in_stg);
+		} else if(selected == MENU_METER || selected == MENU_MEMORY) {
+			// The page took both rows
+			stg_print_settings(fb, &in_stg);
+			stg_print_shape(fb, &in_stg);
+		}
 		*stg = in_stg;
 		last_sel_pressed = sel_pressed;
-		disable_potentiometer();
 		return true;
 	}
 	last_sel_pressed = sel_pressed;
@@ -131,35 +272,64 @@ bool stg_menu_loop(const lcd1602a_t * lcd,
 	if(nav_pressed && !last_nav_pressed) {
 		if(!in_menu) {
 			in_menu = true;
-			enable_potentiometer();
 			in_stg = *stg;
+			stg_print_settings(fb, &in_stg);
+			stg_print_shape(fb, &in_stg);
+		} else if(selected == MENU_METER || selected == MENU_MEMORY) {
+			// The page took both rows
+			stg_print_settings(fb, &in_stg);
+			stg_print_shape(fb, &in_stg);
 		}
 		selected = (selected + 1) % MENU_ENTRIES;
+		// The meter task draws the second row from now on
+		meter_shown = selected == MENU_METER;
+		if(meter_shown) {
+			print_meter_label(fb);
+		}
 	}
 	last_nav_pressed = nav_pressed;
 
 	if(in_menu) {
 		// normalize the acquired data over the custom domain
-		uint8_t selection = (pot_data * menu_cardinality[selected]) / ADC_MAX;
+		uint8_t pot_data  = adc_get(ADC_POT_MENU) >> (ADC_BITS - 8);
+		uint8_t selection = (pot_data * pgm_read_word(&menu_cardinality[selected])) / ADC_MAX;
 		switch (selected) {
 		case MENU_AMPLITUDE:
 			if(in_stg.amplitude != selection) {
 				in_stg.amplitude = selection;
-				stg_print_settings(lcd, &in_stg);
+				stg_print_settings(fb, &in_stg);
 			}
 			break;
 		case MENU_OCTAVE:
 			if(in_stg.octave != selection) {
 				in_stg.octave = selection;
-				stg_print_settings(lcd, &in_stg);
+				stg_print_settings(fb, &in_stg);
 			}
 			break;
 		case MENU_WAVEFORM:
 			if(in_stg.env_shape != selection) {
 				in_stg.env_shape = selection;
-				stg_print_shape(lcd, &in_stg);
+				stg_print_shape(fb, &in_stg);
+			}
+			break;
+		case MENU_ARP_RATE: {
+			uint8_t hz = ARP_RATE_MIN + selection * ARP_RATE_STEP;
+			if(in_stg.arp_rate != hz) {
+				in_stg.arp_rate = hz;
+				print_arp_rate(fb, hz);
 			}
 			break;
+		}
+		case MENU_PRESET:
+			if(in_slot != selection) {
+				in_slot = selection;
+				print_preset(fb, in_slot);
+			}
+			break;
+		case MENU_MEMORY:
+			// A chunk of the scan per call, the page follows each complete one
+			print_memory(fb);
+			break;
 		default:
 			break;
 		}
@@ -171,60 +341,120 @@ bool stg_menu_loop(const lcd1602a_t * lcd,
 /* Print stuff                                                          */
 /************************************************************************/
 
-struct shape_meta {
+// The figures are one row long, stored in flash with the table
+#define FIGURE_SIZE (LCD1602A_COLS + 1)
+
+static const struct shape_meta {
 	uint8_t value;
-	const char * figure;
-} env_shapes[] = {
-	{0,                "________________"},
-	{REVERSE_SAWTOOTH, "\x7|\x7|\x7|\x7|\x7|\x7|\x7|\x7|"},
-	{TRIANGULAR_OOP,   "\x7/\x7/\x7/\x7/\x7/\x7/\x7/\x7/"},
-	{UP_DOWN_CUP,      "\x7/\x6\x6\x6\x6\x6\x6\x6\x6\x6\x6\x6\x6\x6\x6\x6\x6\x6"
-										 "\x6\x6\x6\x6"},
-	{SAWTOOTH,         "/|/|/|/|/|/|/|/|"},
-	{DOWN_CUP,         "/\x6\x6\x6\x6\x6\x6\x6\x6\x6\x6\x6\x6\x6\x6\x6"},
-	{TRIANGULAR,       "/\x7/\x7/\x7/\x7/\x7/\x7/\x7/\x7"},
+	bool buzzer; // The envelope follows the notes, see ay38910_play_buzzer
+	char figure[FIGURE_SIZE];
+} env_shapes[] PROGMEM = {
+	{0,                false, "________________"},
+	{REVERSE_SAWTOOTH, false, "\x7|\x7|\x7|\x7|\x7|\x7|\x7|\x7|"},
+	{TRIANGULAR_OOP,   false, "\x7/\x7/\x7/\x7/\x7/\x7/\x7/\x7/"},
+	{UP_DOWN_CUP,      false, "\x7/\x6\x6\x6\x6\x6\x6\x6\x6\x6\x6\x6\x6\x6\x6"},
+	{SAWTOOTH,         false, "/|/|/|/|/|/|/|/|"},
+	{DOWN_CUP,         false, "/\x6\x6\x6\x6\x6\x6\x6\x6\x6\x6\x6\x6\x6\x6\x6"},
+	{TRIANGULAR,       false, "/\x7/\x7/\x7/\x7/\x7/\x7/\x7/\x7"},
+	{SAWTOOTH,         true,  "buzz /|/|/|/|/|/"},
+	{TRIANGULAR,       true,  "buzz /\x7/\x7/\x7/\x7/\x7/"},
 };
 
 static char print_buf[LCD_BUF_SIZE] = {0};
+static stg_fmt_stats_t fmt_stats   = {0};
 
-void stg_print_settings(const lcd1602a_t * lcd, const settings_t * stg) {
+void stg_print_settings(lcd_fb_t * fb, const settings_t * stg) {
+	// Only the formatting is timed, the row copy is the same in both builds
+	uint32_t start = clock_micros();
+#if defined(UI_SNPRINTF)
 	snprintf(print_buf, LCD_BUF_SIZE, "amp: %d oct: %d", stg->amplitude, stg->octave);
-	lcd1602a_print_row(lcd, print_buf, 0);
+#else
+	char * p = fmt_str_P(print_buf, PSTR("amp: "), 0);
+	p = fmt_udec(p, stg->amplitude, 0, ' ');
+	p = fmt_str_P(p, PSTR(" oct: "), 0);
+	fmt_udec(p, stg->octave, 0, ' ');
+#endif
+	uint16_t us = clock_micros() - start;
+	fmt_stats.calls++;
+	fmt_stats.last_us   = us;
+	fmt_stats.total_us += us;
+	if(us > fmt_stats.max_us) {
+		fmt_stats.max_us = us;
+	}
+	lcd_fb_print_row(fb, print_buf, 0);
 }
 
 
-void stg_print_shape(const lcd1602a_t * lcd, const settings_t * stg) {
-	snprintf(print_buf, LCD_BUF_SIZE, "%s", env_shapes[stg->env_shape].figure);
-	lcd1602a_print_row(lcd, print_buf, 1);
+void stg_print_shape(lcd_fb_t * fb, const settings_t * stg) {
+	memcpy_P(print_buf, env_shapes[stg->env_shape].figure, FIGURE_SIZE);
+	lcd_fb_print_row(fb, print_buf, 1);
 }
 
-uint8_t stg_get_shape_value(const settings_t * stg) {
-	return env_shapes[stg->env_shape].value;
+static void print_preset(lcd_fb_t * fb, uint8_t slot) {
+#if defined(UI_SNPRINTF)
+	snprintf(print_buf, LCD_BUF_SIZE, "preset: %d", slot);
+#else
+	fmt_udec(fmt_str_P(print_buf, PSTR("preset: "), 0), slot, 0, ' ');
+#endif
+	lcd_fb_print_row(fb, print_buf, 0);
 }
 
-/************************************************************************/
-/* Private Helpers                                                      */
-/************************************************************************/
+static void print_arp_rate(lcd_fb_t * fb, uint8_t hz) {
+#if defined(UI_SNPRINTF)
+	snprintf(print_buf, LCD_BUF_SIZE, "arp: %d Hz", hz);
+#else
+	char * p = fmt_udec(fmt_str_P(print_buf, PSTR("arp: "), 0), hz, 0, ' ');
+	fmt_str_P(p, PSTR(" Hz"), 0);
+#endif
+	lcd_fb_print_row(fb, print_buf, 0);
+}
 
-static void adc_init(void) {
-	ADMUX  = (1 << REFS1) | (1 << REFS0) |  // Internal 1.1V ref, ADC0
-					 (1 << ADLAR);                  // Left adjust the result
-	ADCSRA = (1 << ADIE)  |                 // Interrupt mode
-					 (1 << ADPS2) | (1 << ADPS1) | (1 << ADPS0); // 128-prescaling
+static void print_meter_label(lcd_fb_t * fb) {
+	fmt_str_P(print_buf, PSTR("level meter"), 0);
+	lcd_fb_print_row(fb, print_buf, 0);
+}
 
-	ADMUX  |= (POT_CHAN);
-	ADCSRA |= (1 << ADSC);
+static void print_memory(lcd_fb_t * fb) {
+	mem_stats_t st;
+	if(!mem_scan(&st)) {
+		return;
+	}
+#if defined(UI_SNPRINTF)
+	snprintf(print_buf, LCD_BUF_SIZE, "stack max: %u", st.stack_max);
+	lcd_fb_print_row(fb, print_buf, 0);
+	snprintf(print_buf, LCD_BUF_SIZE, "free min: %u", st.free_min);
+#else
+	fmt_udec(fmt_str_P(print_buf, PSTR("stack max: "), 0), st.stack_max, 0, ' ');
+	lcd_fb_print_row(fb, print_buf, 0);
+	fmt_udec(fmt_str_P(print_buf, PSTR("free min: "), 0), st.free_min, 0, ' ');
+#endif
+	lcd_fb_print_row(fb, print_buf, 1);
 }
 
-static void enable_potentiometer(void) {
-	ADCSRA |= (1 << ADEN);
-	ADCSRA |= (1 << ADSC);
+uint8_t stg_get_shape_value(const settings_t * stg) {
+	return pgm_read_byte(&env_shapes[stg->env_shape].value);
 }
 
-static void disable_potentiometer(void) {
-	ADCSRA &= ~(1 << ADEN);
+bool stg_is_buzzer(const settings_t * stg) {
+	return pgm_read_byte(&env_shapes[stg->env_shape].buzzer);
 }
 
+bool stg_in_menu(void) {
+	return in_menu;
+}
+
+bool stg_meter_shown(void) {
+	return meter_shown;
+}
+
+void stg_fmt_stats(stg_fmt_stats_t * st) {
+	*st = fmt_stats;
+}
+
+/************************************************************************/
+/* Private Helpers                                                      */
+/************************************************************************/
+
 static uint8_t u8_from_hex_char(char c) {
 	if(IS_DIGIT(c))  return c - 0x30;
 	if(IS_HEX_HI(c)) return c - 0x37;
@@ -238,17 +468,22 @@ static char 	hex_char_from_u8(uint8_t u) {
 	return 0;
 }
 
-ISR(USART0_RX_vect,) {
-	char recv = (char)*serial->udr;
+/**
+ * Appends a byte to the frame being received.
+ */
+static void receive(char byte) {
 	if(idx < BUF_SIZE) {
-		recv_buf[idx++] = recv;
+		recv_buf[idx++] = byte;
+		if(idx == BUF_SIZE && frame_hook != NULL) {
+			frame_hook();
+		}
 	}
 }
 
-ISR(ADC_vect,) {
-	// TODO acquire in 16 bit mode and mask it? envelope frequency needs 16bit
-	// with left adjustment this register contains ADC[2:9]
-	// and can be read without update problems
-	pot_data = ADCH;
-	ADCSRA |= (1 << ADSC);
+ISR(USART0_RX_vect,) {
+	char recv = (char)*serial->udr;
+	if(byte_hook != NULL) {
+		byte_hook((uint8_t)recv);
+	}
+	receive(recv);
 }
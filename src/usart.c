@@ -26,6 +26,14 @@ void usart_write(const usart_t * usart, const char * msg) {
   }
 }
 
+bool usart_try_write_byte(const usart_t * usart, uint8_t byte) {
+	if(!(*usart->ctl_a & ctla_udre)) {
+		return false;
+	}
+	*usart->udr = byte;
+	return true;
+}
+
 uint8_t usart_read_byte(const usart_t * usart) {
 	while (!(*usart->ctl_a & ctla_rxc));
 	return *usart->udr;